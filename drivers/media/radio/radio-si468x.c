@@ -20,6 +20,8 @@
 #include <linux/videodev2.h>
 #include <linux/mutex.h>
 #include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/uaccess.h>
 #include <media/v4l2-common.h>
 #include <media/v4l2-ioctl.h>
 #include <media/v4l2-ctrls.h>
@@ -32,6 +34,13 @@
 #define DRIVER_NAME "si468x-radio"
 #define DRIVER_CARD "SI468x AM/FM/DAB Receiver"
 
+/* RSSI measurement time of the prefilter pass of the DAB scan (ms) */
+#define SI468X_DAB_PREFILTER_RSSI_TIME	8
+/* no channel reaches it, the prefilter tunes stop after the RSSI */
+#define SI468X_DAB_PREFILTER_RSSI_THRESHOLD	127
+/* RDS blocks copied to the user per access of the core ring */
+#define SI468X_RADIO_RDS_CHUNK		32
+
 enum si468x_freq_bands {
 	SI468X_BAND_AM,
 	SI468X_BAND_FM,
@@ -97,6 +106,12 @@ enum si468x_ctrl_idx {
 	SI468X_IDX_RSSI_THRESHOLD,
 	SI468X_IDX_SNR_THRESHOLD,
 	SI468X_IDX_MAX_TUNE_ERROR,
+	SI468X_IDX_SERVICE_FOLLOWING,
+	SI468X_IDX_FOLLOW_RSSI_THRESHOLD,
+	SI468X_IDX_RDS_MAX_LATENCY,
+	SI468X_IDX_FM_AF,
+	SI468X_IDX_FM_AF_RSSI_THRESHOLD,
+	SI468X_IDX_FM_AF_SNR_THRESHOLD,
 };
 
 static struct v4l2_ctrl_config si468x_ctrls[] = {
@@ -139,6 +154,78 @@ static struct v4l2_ctrl_config si468x_ctrls[] = {
 		.max	= 126 * 2,
 		.step	= 2,
 	},
+	/*
+	 * Switch to a hard linked DAB service in another ensemble or to
+	 * the FM simulcast if the RSSI of the DAB reception falls below
+	 * #V4L2_CID_SI468X_FOLLOW_RSSI_THRESHOLD or it is lost
+	 */
+	[SI468X_IDX_SERVICE_FOLLOWING] = {
+		.ops	= &si468x_ctrl_ops,
+		.id	= V4L2_CID_SI468X_SERVICE_FOLLOWING,
+		.type	= V4L2_CTRL_TYPE_BOOLEAN,
+		.name	= "Service Following",
+		.min	= 0,
+		.max	= 1,
+		.step	= 1,
+	},
+	[SI468X_IDX_FOLLOW_RSSI_THRESHOLD] = {
+		.ops	= &si468x_ctrl_ops,
+		.id	= V4L2_CID_SI468X_FOLLOW_RSSI_THRESHOLD,
+		.type	= V4L2_CTRL_TYPE_INTEGER,
+		.name	= "Service Following RSSI Threshold",
+		.min	= -128,
+		.max	= 127,
+		.step	= 1,
+		.def	= SI468X_FOLLOW_RSSI_LOW_DEFAULT,
+	},
+	/*
+	 * The RDS interrupt threshold follows the group rate, so a group
+	 * waits at most #V4L2_CID_SI468X_RDS_MAX_LATENCY ms in the chip
+	 */
+	[SI468X_IDX_RDS_MAX_LATENCY] = {
+		.ops	= &si468x_ctrl_ops,
+		.id	= V4L2_CID_SI468X_RDS_MAX_LATENCY,
+		.type	= V4L2_CTRL_TYPE_INTEGER,
+		.name	= "RDS Max Latency (ms)",
+		.min	= 0,
+		.max	= 10000,
+		.step	= 1,
+		.def	= SI468X_RDS_LATENCY_DEFAULT,
+	},
+	/*
+	 * Retune to an alternative frequency carrying the same PI code if
+	 * the FM reception falls below #V4L2_CID_SI468X_FM_AF_RSSI_THRESHOLD
+	 * or #V4L2_CID_SI468X_FM_AF_SNR_THRESHOLD
+	 */
+	[SI468X_IDX_FM_AF] = {
+		.ops	= &si468x_ctrl_ops,
+		.id	= V4L2_CID_SI468X_FM_AF,
+		.type	= V4L2_CTRL_TYPE_BOOLEAN,
+		.name	= "FM AF Switching",
+		.min	= 0,
+		.max	= 1,
+		.step	= 1,
+	},
+	[SI468X_IDX_FM_AF_RSSI_THRESHOLD] = {
+		.ops	= &si468x_ctrl_ops,
+		.id	= V4L2_CID_SI468X_FM_AF_RSSI_THRESHOLD,
+		.type	= V4L2_CTRL_TYPE_INTEGER,
+		.name	= "FM AF RSSI Threshold",
+		.min	= -128,
+		.max	= 127,
+		.step	= 1,
+		.def	= SI468X_AF_RSSI_LOW_DEFAULT,
+	},
+	[SI468X_IDX_FM_AF_SNR_THRESHOLD] = {
+		.ops	= &si468x_ctrl_ops,
+		.id	= V4L2_CID_SI468X_FM_AF_SNR_THRESHOLD,
+		.type	= V4L2_CTRL_TYPE_INTEGER,
+		.name	= "FM AF SNR Threshold",
+		.min	= -128,
+		.max	= 127,
+		.step	= 1,
+		.def	= SI468X_AF_SNR_LOW_DEFAULT,
+	},
 };
 
 struct si468x_radio;
@@ -173,7 +260,8 @@ struct si468x_radio_ops {
 			  struct si468x_agc_status_report *);
 };
 
-static struct si468x_dab_frequency dab_freq_list[] = {
+/* Band III channels, copied into every radio as its scan list */
+static const struct si468x_dab_frequency si468x_dab_band_iii[] = {
 	{ .frequency = 174928, .name = "5A", },
 	{ .frequency = 176640, .name = "5B", },
 	{ .frequency = 178352, .name = "5C", },
@@ -217,8 +305,6 @@ static struct si468x_dab_frequency dab_freq_list[] = {
 	{ .frequency = 239200, .name = "13F", },
 };
 
-static struct si468x_dab_frequency loaded_dab_freq_list[SI468X_DAB_MAX_FREQUENCIES] = {};
-
 /**
  * struct si468x_radio - radio device
  *
@@ -231,6 +317,16 @@ static struct si468x_dab_frequency loaded_dab_freq_list[SI468X_DAB_MAX_FREQUENCI
  * @debugfs: pointer to &strucd dentry for debugfs
  * @audmode: audio mode, as defined for the rxsubchans field
  *	     at videodev2.h
+ * @dab_freq_list: Band III channels with the result of the last scan
+ * @core_nb: receives the events of the core
+ * @rds_work: copies the decoded RDS of the core into the RDS controls,
+ *	      the core notifies with its lock held
+ * @rds_pty: V4L2_CID_RDS_RX_PTY
+ * @rds_ps: V4L2_CID_RDS_RX_PS_NAME
+ * @rds_rt: V4L2_CID_RDS_RX_RADIO_TEXT
+ * @rds_ta: V4L2_CID_RDS_RX_TRAFFIC_ANNOUNCEMENT
+ * @rds_tp: V4L2_CID_RDS_RX_TRAFFIC_PROGRAM
+ * @rds_ms: V4L2_CID_RDS_RX_MUSIC_SPEECH
  *
  * core structure is the radio device is being used
  */
@@ -247,8 +343,38 @@ struct si468x_radio {
 
 	struct dentry	*debugfs;
 	u32 audmode;
+
+	struct si468x_dab_frequency dab_freq_list[ARRAY_SIZE(si468x_dab_band_iii)];
+
+	struct notifier_block core_nb;
+
+	struct work_struct rds_work;
+	struct v4l2_ctrl *rds_pty;
+	struct v4l2_ctrl *rds_ps;
+	struct v4l2_ctrl *rds_rt;
+	struct v4l2_ctrl *rds_ta;
+	struct v4l2_ctrl *rds_tp;
+	struct v4l2_ctrl *rds_ms;
 };
 
+/**
+ * struct si468x_radio_fh - file handle of the radio device
+ *
+ * @fh: V4L2 file handle
+ * @rds_lock: serializes read() on the file handle
+ * @rds_cursor: next RDS block of the core ring to read
+ */
+struct si468x_radio_fh {
+	struct v4l2_fh fh;
+	struct mutex rds_lock;
+	u32 rds_cursor;
+};
+
+static inline struct si468x_radio_fh *file_to_radio_fh(struct file *file)
+{
+	return container_of(file->private_data, struct si468x_radio_fh, fh);
+}
+
 static inline struct si468x_radio *v4l2_dev_to_radio(struct v4l2_device *d)
 {
 	return container_of(d, struct si468x_radio, v4l2dev);
@@ -278,11 +404,11 @@ static inline u32 hz_to_si468x(struct si468x_core *core, u32 freq)
 		break;
 	case SI468X_FUNC_DAB_RECEIVER:
 		freq = freq / 1000; /* DAB uses kHz */
-		while (loaded_dab_freq_list[cnt].frequency) {
-			diff = abs(freq - loaded_dab_freq_list[cnt].frequency);
+		while (core->loaded_dab_freq_list[cnt].frequency) {
+			diff = abs(freq - core->loaded_dab_freq_list[cnt].frequency);
 			if (diff < closest) {
 				closest = diff;
-				result = loaded_dab_freq_list[cnt].frequency;
+				result = core->loaded_dab_freq_list[cnt].frequency;
 			}
 			cnt++;
 		}
@@ -558,11 +684,87 @@ static int si468x_radio_init_vtable(struct si468x_radio *radio,
 	}
 }
 
+/**
+ * si468x_radio_dab_prefilter() - find the DAB channels worth a full tune
+ * @radio: radio device
+ * @args: tune arguments
+ * @candidates: bitmap of channels in @radio->dab_freq_list to fill
+ *
+ * The RSSI threshold of the chip is raised above any signal and the
+ * RSSI time shortened, so every tune stops right after the RSSI was
+ * measured, without fast detect and acquisition. TEST_GET_RSSI then
+ * reads the RSSI. Channels at or above the DAB_VALID_RSSI_THRESHOLD
+ * are candidates, and so are channels whose RSSI could not be read.
+ *
+ * Returns the number of candidates or a negative error code.
+ */
+static int si468x_radio_dab_prefilter(struct si468x_radio *radio,
+				      struct si468x_tune_freq_args *args,
+				      unsigned long *candidates)
+{
+	struct si468x_dab_frequency *dab_freq_list = radio->dab_freq_list;
+	unsigned int rssi_time, rssi_threshold;
+	int err, restore;
+	int i, cnt = 0;
+	s16 rssi;
+
+	err = regmap_read(radio->core->regmap_dab,
+			  SI468X_PROP_DAB_VALID_RSSI_TIME, &rssi_time);
+	if (err < 0)
+		return err;
+	err = regmap_read(radio->core->regmap_dab,
+			  SI468X_PROP_DAB_VALID_RSSI_THRESHOLD,
+			  &rssi_threshold);
+	if (err < 0)
+		return err;
+
+	err = regmap_write(radio->core->regmap_dab,
+			   SI468X_PROP_DAB_VALID_RSSI_TIME,
+			   SI468X_DAB_PREFILTER_RSSI_TIME);
+	if (err < 0)
+		goto restore;
+	err = regmap_write(radio->core->regmap_dab,
+			   SI468X_PROP_DAB_VALID_RSSI_THRESHOLD,
+			   SI468X_DAB_PREFILTER_RSSI_THRESHOLD);
+	if (err < 0)
+		goto restore;
+
+	for (i = 0; i < ARRAY_SIZE(radio->dab_freq_list); i++) {
+		args->dab_freq_list = dab_freq_list;
+		args->freq = dab_freq_list[i].frequency;
+		err = radio->ops->tune_freq(radio->core, args);
+		if (err < 0)
+			goto restore;
+		err = si468x_core_cmd_test_get_rssi(radio->core, &rssi);
+		/* 8.8 fixed point, a channel without RSSI gets the full tune */
+		if (err < 0 || rssi >= (s16)((s8)rssi_threshold * 256)) {
+			set_bit(i, candidates);
+			cnt++;
+		}
+	}
+	err = cnt;
+
+restore:
+	restore = regmap_write(radio->core->regmap_dab,
+			       SI468X_PROP_DAB_VALID_RSSI_TIME, rssi_time);
+	if (restore >= 0)
+		restore = regmap_write(radio->core->regmap_dab,
+				       SI468X_PROP_DAB_VALID_RSSI_THRESHOLD,
+				       rssi_threshold);
+
+	if (err >= 0 && restore < 0)
+		err = restore;
+
+	return err;
+}
+
 static int si468x_radio_dab_load_valid_frequencies(struct si468x_radio *radio,
 						   struct si468x_tune_freq_args *args)
 {
 	int err;
-	int i, cnt = 0;
+	int i, cnt = 0, candidates_cnt;
+	ktime_t start = ktime_get();
+	DECLARE_BITMAP(candidates, ARRAY_SIZE(si468x_dab_band_iii)) = { 0 };
 	struct si468x_rsq_status_report rsq_report;
 	struct si468x_rsq_status_args rsq_args = {
 		.rsqack		= false,
@@ -573,15 +775,29 @@ static int si468x_radio_dab_load_valid_frequencies(struct si468x_radio *radio,
 		.stcack		= false,
 	};
 
+	struct si468x_dab_frequency *dab_freq_list = radio->dab_freq_list;
+	struct si468x_dab_frequency *loaded_dab_freq_list =
+		radio->core->loaded_dab_freq_list;
+
 	err = si468x_core_cmd_dab_set_freq_list(
 				radio->core,
 				dab_freq_list,
-				ARRAY_SIZE(dab_freq_list),
+				ARRAY_SIZE(radio->dab_freq_list),
 				SI468X_DAB_MAX_FREQUENCIES);
 	if (err < 0)
 		return err;
-	memset(loaded_dab_freq_list, 0, sizeof(loaded_dab_freq_list));
-	for (i = 0; i < ARRAY_SIZE(dab_freq_list); i++) {
+	si468x_core_dab_forget(radio->core);
+
+	/* first pass: cheap energy check of the whole band */
+	candidates_cnt = si468x_radio_dab_prefilter(radio, args, candidates);
+	if (candidates_cnt < 0)
+		return candidates_cnt;
+
+	/* second pass: full acquisition of the candidates only */
+	for (i = 0; i < ARRAY_SIZE(radio->dab_freq_list); i++) {
+		dab_freq_list[i].is_valid = false;
+		if (!test_bit(i, candidates))
+			continue;
 		args->dab_freq_list = dab_freq_list;
 		args->freq = dab_freq_list[i].frequency;
 		err = radio->ops->tune_freq(radio->core, args);
@@ -599,6 +815,11 @@ static int si468x_radio_dab_load_valid_frequencies(struct si468x_radio *radio,
 		}
 	}
 
+	dev_dbg(radio->v4l2dev.dev,
+		"DAB scan: %d of %d channels prefiltered, %d valid, %lld ms\n",
+		candidates_cnt, (int)ARRAY_SIZE(radio->dab_freq_list), cnt,
+		ktime_ms_delta(ktime_get(), start));
+
 	if (cnt == 0)
 		return -EINVAL;
 
@@ -619,8 +840,8 @@ static int si468x_radio_dab_get_ensembles(struct si468x_radio *radio,
 					  struct si468x_tune_freq_args *args)
 {
 	atomic_set(&radio->core->dab_full_scan, 1);
-	args->dab_freq_list = loaded_dab_freq_list;
-	args->freq = loaded_dab_freq_list[0].frequency;
+	args->dab_freq_list = radio->core->loaded_dab_freq_list;
+	args->freq = radio->core->loaded_dab_freq_list[0].frequency;
 	return radio->ops->tune_freq(radio->core, args);
 /* wait for list in si468x_core_new_digital_service_list */
 }
@@ -658,6 +879,15 @@ static int si468x_radio_pretune(struct si468x_radio *radio,
 		retval = radio->ops->tune_freq(radio->core, &args);
 		break;
 	case SI468X_FUNC_DAB_RECEIVER:
+		/* revalidated by the service list interrupt */
+		retval = si468x_core_dab_start_cached(radio->core);
+		if (!(retval < 0))
+			break;
+		if (retval != -ENOENT)
+			dev_info(radio->v4l2dev.dev,
+				 "Cached DAB service failed (%d), rescanning\n",
+				 retval);
+
 		retval = si468x_radio_dab_load_valid_frequencies(radio, &args);
 		if (retval < 0)
 			return retval;
@@ -682,26 +912,22 @@ static int si468x_radio_do_post_powerup_init(struct si468x_radio *radio,
 	    (func == SI468X_FUNC_BOOTLOADER))
 		return 0;
 
-	regcache_mark_dirty(radio->core->regmap_common);
-	regcache_cache_only(radio->core->regmap_common, false);
-	err = regcache_sync(radio->core->regmap_common);
+	err = si468x_core_sync_properties(radio->core,
+					  radio->core->regmap_common);
 	if (err < 0)
 		return err;
 	switch (func) {
 	case SI468X_FUNC_AM_RECEIVER:
-		regcache_mark_dirty(radio->core->regmap_am);
-		regcache_cache_only(radio->core->regmap_am, false);
-		err = regcache_sync(radio->core->regmap_am);
+		err = si468x_core_sync_properties(radio->core,
+						  radio->core->regmap_am);
 		break;
 	case SI468X_FUNC_FM_RECEIVER:
-		regcache_mark_dirty(radio->core->regmap_fm);
-		regcache_cache_only(radio->core->regmap_fm, false);
-		err = regcache_sync(radio->core->regmap_fm);
+		err = si468x_core_sync_properties(radio->core,
+						  radio->core->regmap_fm);
 		break;
 	case SI468X_FUNC_DAB_RECEIVER:
-		regcache_mark_dirty(radio->core->regmap_dab);
-		regcache_cache_only(radio->core->regmap_dab, false);
-		err = regcache_sync(radio->core->regmap_dab);
+		err = si468x_core_sync_properties(radio->core,
+						  radio->core->regmap_dab);
 		break;
 	default:
 		err = -EINVAL;
@@ -822,7 +1048,7 @@ static int si468x_radio_s_frequency(struct file *file, void *priv,
 	args.antcap		= 0;
 	args.direct_tune	= SI468X_SELECT_MAIN_PROGRAM_SERVICE;
 	args.program_id		= 0;
-	args.dab_freq_list	= loaded_dab_freq_list;
+	args.dab_freq_list	= radio->core->loaded_dab_freq_list;
 	if (radio->core->si468x_device_info->has_hd)
 		args.tunemode	= SI468X_TUNEMODE_FAST_WITH_HD;
 	else
@@ -1123,9 +1349,40 @@ static int si468x_radio_s_ctrl(struct v4l2_ctrl *ctrl)
 			break;
 		}
 		break;
+	case V4L2_CID_SI468X_SERVICE_FOLLOWING:
+		retval = si468x_core_set_service_following(radio->core,
+						ctrl->val,
+						radio->core->follow.rssi_low);
+		break;
+	case V4L2_CID_SI468X_FOLLOW_RSSI_THRESHOLD:
+		retval = si468x_core_set_service_following(radio->core,
+						radio->core->follow.enabled,
+						ctrl->val);
+		break;
+	case V4L2_CID_SI468X_RDS_MAX_LATENCY:
+		retval = si468x_core_set_rds_latency(radio->core, ctrl->val);
+		break;
+	case V4L2_CID_SI468X_FM_AF:
+		retval = si468x_core_set_fm_af(radio->core, ctrl->val,
+					       radio->core->af.rssi_low,
+					       radio->core->af.snr_low);
+		break;
+	case V4L2_CID_SI468X_FM_AF_RSSI_THRESHOLD:
+		retval = si468x_core_set_fm_af(radio->core,
+					       radio->core->af.enabled,
+					       ctrl->val,
+					       radio->core->af.snr_low);
+		break;
+	case V4L2_CID_SI468X_FM_AF_SNR_THRESHOLD:
+		retval = si468x_core_set_fm_af(radio->core,
+					       radio->core->af.enabled,
+					       radio->core->af.rssi_low,
+					       ctrl->val);
+		break;
 	case V4L2_CID_RDS_RECEPTION:
 		if (si468x_core_is_in_fm_receiver_mode(radio->core)) {
 			if (ctrl->val) {
+				si468x_core_reset_rds_rate(radio->core);
 				retval = regmap_write(radio->core->regmap_fm,
 						      SI468X_PROP_FM_RDS_INTERRUPT_FIFO_COUNT,
 						      radio->core->rds_fifo_depth);
@@ -1246,56 +1503,76 @@ done:
 static int si468x_radio_fops_open(struct file *file)
 {
 	struct si468x_radio *radio = video_drvdata(file);
-	int err;
+	struct si468x_radio_fh *rfh;
 
-	err = v4l2_fh_open(file);
-	if (err)
-		return err;
+	rfh = kzalloc(sizeof(*rfh), GFP_KERNEL);
+	if (!rfh)
+		return -ENOMEM;
+
+	mutex_init(&rfh->rds_lock);
+	rfh->rds_cursor = si468x_core_rds_cursor(radio->core);
+	v4l2_fh_init(&rfh->fh, &radio->videodev);
+	file->private_data = &rfh->fh;
+	v4l2_fh_add(&rfh->fh);
 
 	if (v4l2_fh_is_singular_file(file)) {
 		schedule_work(&radio->load_firmware_async);
 		v4l2_ctrl_handler_setup(&radio->ctrl_handler);
 	}
 
-	return err;
+	return 0;
 }
 
 static int si468x_radio_fops_release(struct file *file)
 {
-	int err;
+	struct si468x_radio_fh *rfh = file_to_radio_fh(file);
 	struct si468x_radio *radio = video_drvdata(file);
 
 	if (v4l2_fh_is_singular_file(file) &&
-	    atomic_read(&radio->core->is_alive))
+	    atomic_read(&radio->core->is_alive)) {
+		si468x_core_lock(radio->core);
 		si473x_core_set_power_state(radio->core,
 					    SI468X_STATE_POWER_DOWN);
+		si468x_core_unlock(radio->core);
+	}
 
-	err = v4l2_fh_release(file);
+	v4l2_fh_del(&rfh->fh);
+	v4l2_fh_exit(&rfh->fh);
+	mutex_destroy(&rfh->rds_lock);
+	kfree(rfh);
+	file->private_data = NULL;
 
 	/* boot to FM next time (probing is faster with mini patch) */
 	if ((radio->core->power_up_parameters.func == SI468X_FUNC_MINI_BOOT) ||
 	    (radio->core->power_up_parameters.func == SI468X_FUNC_BOOTLOADER))
 		radio->core->power_up_parameters.func = SI468X_FUNC_FM_RECEIVER;
 
-	return err;
+	return 0;
 }
 
 static ssize_t si468x_radio_fops_read(struct file *file, char __user *buf,
 				      size_t count, loff_t *ppos)
 {
+	struct v4l2_rds_data blocks[SI468X_RADIO_RDS_CHUNK];
+	struct si468x_radio_fh *rfh = file_to_radio_fh(file);
+	struct si468x_radio *radio = video_drvdata(file);
+	size_t       copied = 0;
 	ssize_t      rval;
-	size_t       fifo_len;
-	unsigned int copied;
+	int          n;
 
-	struct si468x_radio *radio = video_drvdata(file);
+	/* only whole blocks */
+	count -= count % sizeof(blocks[0]);
+	if (!count)
+		return 0;
 
 	/* block if no new data available */
-	if (kfifo_is_empty(&radio->core->rds_fifo)) {
+	if (!si468x_core_rds_pending(radio->core, rfh->rds_cursor)) {
 		if (file->f_flags & O_NONBLOCK)
 			return -EWOULDBLOCK;
 
 		rval = wait_event_interruptible(radio->core->rds_read_queue,
-						(!kfifo_is_empty(&radio->core->rds_fifo) ||
+						(si468x_core_rds_pending(radio->core,
+									 rfh->rds_cursor) ||
 						 !atomic_read(&radio->core->is_alive)));
 		if (rval < 0)
 			return -EINTR;
@@ -1304,19 +1581,27 @@ static ssize_t si468x_radio_fops_read(struct file *file, char __user *buf,
 			return -ENODEV;
 	}
 
-	fifo_len = kfifo_len(&radio->core->rds_fifo);
+	if (mutex_lock_interruptible(&rfh->rds_lock))
+		return -EINTR;
 
-	if (kfifo_to_user(&radio->core->rds_fifo, buf,
-			  min(fifo_len, count),
-			  &copied) != 0) {
-		dev_warn(&radio->videodev.dev,
-			 "Error during FIFO to userspace copy\n");
-		rval = -EIO;
-	} else {
-		rval = (ssize_t)copied;
+	while (copied < count) {
+		n = si468x_core_read_rds_blocks(radio->core, &rfh->rds_cursor,
+						blocks,
+						min_t(size_t, ARRAY_SIZE(blocks),
+						      (count - copied) /
+						      sizeof(blocks[0])));
+		if (!n)
+			break;
+		if (copy_to_user(buf + copied, blocks, n * sizeof(blocks[0]))) {
+			mutex_unlock(&rfh->rds_lock);
+			return -EFAULT;
+		}
+		copied += n * sizeof(blocks[0]);
 	}
 
-	return rval;
+	mutex_unlock(&rfh->rds_lock);
+
+	return copied;
 }
 
 static __poll_t si468x_radio_fops_poll(struct file *file,
@@ -1333,13 +1618,141 @@ static __poll_t si468x_radio_fops_poll(struct file *file,
 		if (!atomic_read(&radio->core->is_alive))
 			err = EPOLLHUP;
 
-		if (!kfifo_is_empty(&radio->core->rds_fifo))
+		if (si468x_core_rds_pending(radio->core,
+					    file_to_radio_fh(file)->rds_cursor))
 			err = EPOLLIN | EPOLLRDNORM;
 	}
 
 	return err;
 }
 
+static int si468x_radio_subscribe_event(struct v4l2_fh *fh,
+					const struct v4l2_event_subscription *sub)
+{
+	switch (sub->type) {
+	case V4L2_EVENT_SI468X_MOT_IMAGE:
+	case V4L2_EVENT_SI468X_DLS:
+	case V4L2_EVENT_SI468X_FOLLOW_FM:
+		return v4l2_event_subscribe(fh, sub, 1, NULL);
+	default:
+		return v4l2_ctrl_subscribe_event(fh, sub);
+	}
+}
+
+/*
+ * Service following lost the DAB service, continue with the FM simulcast.
+ * The application learns about the band change from the
+ * V4L2_EVENT_SI468X_FOLLOW_FM event. Called with the core lock held.
+ */
+static int si468x_radio_follow_fm(struct si468x_radio *radio,
+				  const struct si468x_follow_freq *fi)
+{
+	struct si468x_tune_freq_args args = {
+		.injside	= SI468X_INJSIDE_AUTO,
+		.antcap		= 0,
+		.direct_tune	= SI468X_SELECT_MAIN_PROGRAM_SERVICE,
+		.program_id	= 0,
+	};
+	struct v4l2_event ev = {
+		.type	= V4L2_EVENT_SI468X_FOLLOW_FM,
+	};
+	struct si468x_follow_fm_event *follow =
+		(struct si468x_follow_fm_event *)ev.u.data;
+	int err;
+
+	if (!si468x_radio_freq_is_inside_of_the_band(hz_to_v4l2(fi->freq * 1000),
+						     SI468X_BAND_FM))
+		return -ERANGE;
+
+	err = si468x_radio_change_func(radio, SI468X_FUNC_FM_RECEIVER);
+	if (err < 0)
+		return err;
+
+	args.freq = hz_to_si468x(radio->core, fi->freq * 1000);
+	if (radio->core->si468x_device_info->has_hd)
+		args.tunemode	= SI468X_TUNEMODE_FAST_WITH_HD;
+	else
+		args.tunemode	= SI468X_TUNEMODE_FAST_NO_HD;
+
+	err = radio->ops->tune_freq(radio->core, &args);
+	if (err < 0)
+		return err;
+
+	follow->service_id = radio->core->follow.service_id;
+	follow->frequency = hz_to_v4l2(fi->freq * 1000);
+	follow->pi = fi->id;
+	v4l2_event_queue(&radio->videodev, &ev);
+
+	return 0;
+}
+
+/*
+ * The controls are set without the core lock, they have no s_ctrl and
+ * send the change events themselves.
+ */
+static void si468x_radio_update_rds(struct work_struct *work)
+{
+	struct si468x_radio *radio = container_of(work, struct si468x_radio,
+						  rds_work);
+	struct si468x_rds rds;
+
+	si468x_core_read_rds(radio->core, &rds);
+
+	v4l2_ctrl_s_ctrl(radio->rds_pty, rds.pty);
+	v4l2_ctrl_s_ctrl(radio->rds_ta, rds.ta);
+	v4l2_ctrl_s_ctrl(radio->rds_tp, rds.tp);
+	v4l2_ctrl_s_ctrl(radio->rds_ms, rds.ms);
+	v4l2_ctrl_s_ctrl_string(radio->rds_ps, rds.ps);
+	v4l2_ctrl_s_ctrl_string(radio->rds_rt, rds.rt);
+}
+
+/* called by the core with its lock held */
+static int si468x_radio_core_event(struct notifier_block *nb,
+				   unsigned long action, void *data)
+{
+	struct si468x_radio *radio = container_of(nb, struct si468x_radio,
+						  core_nb);
+	const struct si468x_mot_object *obj;
+	struct si468x_mot_image_event *mot;
+	const struct si468x_dls *dls;
+	struct si468x_dls_event *label;
+	struct v4l2_event ev = {};
+
+	switch (action) {
+	case SI468X_EVENT_RDS:
+		schedule_work(&radio->rds_work);
+		return NOTIFY_OK;
+	case SI468X_EVENT_FOLLOW_FM:
+		return notifier_from_errno(si468x_radio_follow_fm(radio, data));
+	case SI468X_EVENT_MOT_IMAGE:
+		obj = data;
+		mot = (struct si468x_mot_image_event *)ev.u.data;
+		ev.type = V4L2_EVENT_SI468X_MOT_IMAGE;
+		mot->seq = obj->seq;
+		mot->service_id = obj->service_id;
+		mot->size = obj->size;
+		mot->transport_id = obj->transport_id;
+		mot->content_subtype = obj->content_subtype;
+		break;
+	case SI468X_EVENT_DLS:
+		dls = data;
+		label = (struct si468x_dls_event *)ev.u.data;
+		ev.type = V4L2_EVENT_SI468X_DLS;
+		label->change = dls->change;
+		label->nr_tags = dls->nr_tags;
+		label->item_toggle = dls->item_toggle;
+		label->item_running = dls->item_running;
+		strscpy(label->text, dls->text, sizeof(label->text));
+		break;
+	default:
+		return NOTIFY_DONE;
+	}
+
+	v4l2_event_queue(&radio->videodev, &ev);
+
+	return NOTIFY_OK;
+}
+
 static const struct v4l2_file_operations si468x_fops = {
 	.owner			= THIS_MODULE,
 	.read			= si468x_radio_fops_read,
@@ -1360,7 +1773,7 @@ static const struct v4l2_ioctl_ops si4761_ioctl_ops = {
 	.vidioc_s_hw_freq_seek		= si468x_radio_s_hw_freq_seek,
 	.vidioc_enum_freq_bands		= si468x_radio_enum_freq_bands,
 
-	.vidioc_subscribe_event		= v4l2_ctrl_subscribe_event,
+	.vidioc_subscribe_event		= si468x_radio_subscribe_event,
 	.vidioc_unsubscribe_event	= v4l2_event_unsubscribe,
 
 #ifdef CONFIG_VIDEO_ADV_DEBUG
@@ -1605,11 +2018,13 @@ static int si468x_radio_probe(struct platform_device *pdev)
 	platform_set_drvdata(pdev, radio);
 
 	INIT_WORK(&radio->load_firmware_async, si468x_radio_load_firmware_async);
-	radio->core->loaded_dab_freq_list = loaded_dab_freq_list;
+	INIT_WORK(&radio->rds_work, si468x_radio_update_rds);
+	memcpy(radio->dab_freq_list, si468x_dab_band_iii,
+	       sizeof(radio->dab_freq_list));
 
 	radio->v4l2dev.ctrl_handler = &radio->ctrl_handler;
 	v4l2_ctrl_handler_init(&radio->ctrl_handler,
-			       1 + ARRAY_SIZE(si468x_ctrls));
+			       11 + ARRAY_SIZE(si468x_ctrls));
 
 	rval = si468x_radio_add_new_custom(radio, SI468X_IDX_RSSI_THRESHOLD);
 	if (rval < 0)
@@ -1623,6 +2038,36 @@ static int si468x_radio_probe(struct platform_device *pdev)
 	if (rval < 0)
 		goto exit;
 
+	if (radio->core->si468x_device_info->has_dab) {
+		rval = si468x_radio_add_new_custom(radio,
+						   SI468X_IDX_SERVICE_FOLLOWING);
+		if (rval < 0)
+			goto exit;
+
+		rval = si468x_radio_add_new_custom(radio,
+						   SI468X_IDX_FOLLOW_RSSI_THRESHOLD);
+		if (rval < 0)
+			goto exit;
+	}
+
+	rval = si468x_radio_add_new_custom(radio, SI468X_IDX_RDS_MAX_LATENCY);
+	if (rval < 0)
+		goto exit;
+
+	rval = si468x_radio_add_new_custom(radio, SI468X_IDX_FM_AF);
+	if (rval < 0)
+		goto exit;
+
+	rval = si468x_radio_add_new_custom(radio,
+					   SI468X_IDX_FM_AF_RSSI_THRESHOLD);
+	if (rval < 0)
+		goto exit;
+
+	rval = si468x_radio_add_new_custom(radio,
+					   SI468X_IDX_FM_AF_SNR_THRESHOLD);
+	if (rval < 0)
+		goto exit;
+
 	ctrl = v4l2_ctrl_new_std_menu(&radio->ctrl_handler,
 				      &si468x_ctrl_ops,
 				      V4L2_CID_TUNE_DEEMPHASIS,
@@ -1665,6 +2110,30 @@ static int si468x_radio_probe(struct platform_device *pdev)
 		goto exit;
 	}
 
+	radio->rds_pty = v4l2_ctrl_new_std(&radio->ctrl_handler, NULL,
+					   V4L2_CID_RDS_RX_PTY, 0, 31, 1, 0);
+	radio->rds_ta = v4l2_ctrl_new_std(&radio->ctrl_handler, NULL,
+					  V4L2_CID_RDS_RX_TRAFFIC_ANNOUNCEMENT,
+					  0, 1, 1, 0);
+	radio->rds_tp = v4l2_ctrl_new_std(&radio->ctrl_handler, NULL,
+					  V4L2_CID_RDS_RX_TRAFFIC_PROGRAM,
+					  0, 1, 1, 0);
+	radio->rds_ms = v4l2_ctrl_new_std(&radio->ctrl_handler, NULL,
+					  V4L2_CID_RDS_RX_MUSIC_SPEECH,
+					  0, 1, 1, 1);
+	radio->rds_ps = v4l2_ctrl_new_std(&radio->ctrl_handler, NULL,
+					  V4L2_CID_RDS_RX_PS_NAME,
+					  0, SI468X_RDS_PS_LENGTH, 8, 0);
+	radio->rds_rt = v4l2_ctrl_new_std(&radio->ctrl_handler, NULL,
+					  V4L2_CID_RDS_RX_RADIO_TEXT,
+					  0, SI468X_RDS_RT_LENGTH, 64, 0);
+	rval = radio->ctrl_handler.error;
+	if (rval) {
+		dev_err(&pdev->dev, "Could not initialize RDS controls %d\n",
+			rval);
+		goto exit;
+	}
+
 	/* register video device */
 	rval = video_register_device(&radio->videodev, VFL_TYPE_RADIO, -1);
 	if (rval < 0) {
@@ -1678,6 +2147,9 @@ static int si468x_radio_probe(struct platform_device *pdev)
 		goto exit;
 	}
 
+	radio->core_nb.notifier_call = si468x_radio_core_event;
+	si468x_core_register_notifier(radio->core, &radio->core_nb);
+
 	return 0;
 exit:
 	v4l2_ctrl_handler_free(radio->videodev.ctrl_handler);
@@ -1688,6 +2160,8 @@ static int si468x_radio_remove(struct platform_device *pdev)
 {
 	struct si468x_radio *radio = platform_get_drvdata(pdev);
 
+	si468x_core_unregister_notifier(radio->core, &radio->core_nb);
+	cancel_work_sync(&radio->rds_work);
 	v4l2_ctrl_handler_free(radio->videodev.ctrl_handler);
 	video_unregister_device(&radio->videodev);
 	v4l2_device_unregister(&radio->v4l2dev);
@@ -0,0 +1,256 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * drivers/mfd/si468x-af.c -- FM alternative frequencies of si468x chips
+ *
+ * Copyright (C) 2020 HTL Steyr - Austria
+ * Copyright (C) 2020 Franz Parzer
+ *
+ * Author: Franz Parzer <rpi-receiver@htl-steyr.ac.at>
+ *
+ * The RDS decoder collects the alternative frequencies (AF) of the tuned
+ * PI code. The chip raises the RSQ interrupt once the RSSI or the SNR
+ * falls below the thresholds. If the reception is still degraded
+ * SI468X_AF_HOLDOFF ms later, up to SI468X_AF_MAX_CHECKS AFs are
+ * measured with quick tunes and the strongest ones are tried until one
+ * carries the same PI code. If none is better, the chip is tuned back.
+ * The RDS of the program is kept while checking. Everything runs with
+ * the core lock held.
+ */
+#include <linux/module.h>
+#include <linux/jiffies.h>
+#include <linux/sort.h>
+
+#include <linux/mfd/si468x-core.h>
+#include "si468x-cmd_priv.h"
+
+struct si468x_af_candidate {
+	u32 freq;
+	s8  rssi;
+};
+
+static int si468x_af_cmp(const void *a, const void *b)
+{
+	const struct si468x_af_candidate *ca = a, *cb = b;
+
+	/* strongest first */
+	return cb->rssi - ca->rssi;
+}
+
+static int si468x_af_measure(struct si468x_core *core, bool ack,
+			     struct si468x_rsq_status_report *rsq)
+{
+	struct si468x_rsq_status_args args = {
+		.rsqack		= ack,
+	};
+
+	return si468x_core_cmd_fm_rsq_status(core, &args, rsq);
+}
+
+static bool si468x_af_reception_ok(struct si468x_core *core,
+				   const struct si468x_rsq_status_report *rsq)
+{
+	return rsq->valid && rsq->rssi >= core->af.rssi_low &&
+	       rsq->snr >= core->af.snr_low;
+}
+
+/* @freq in kHz, quick tune without HD acquisition */
+static int si468x_af_tune(struct si468x_core *core, u32 freq)
+{
+	struct si468x_tune_freq_args args = {
+		.injside	= SI468X_INJSIDE_AUTO,
+		.freq		= freq / 10,
+		.tunemode	= SI468X_TUNEMODE_FAST_NO_HD,
+		.antcap		= 0,
+		.direct_tune	= SI468X_SELECT_MAIN_PROGRAM_SERVICE,
+		.program_id	= 0,
+	};
+
+	return __si468x_core_cmd_fm_tune_freq(core, &args);
+}
+
+/*
+ * AFs stronger than the tuned frequency, strongest first. Returns
+ * -ENOENT if there was no AF to measure.
+ */
+static int si468x_af_candidates(struct si468x_core *core, u32 cur,
+				s8 rssi, const u32 *afs, int nr_afs,
+				struct si468x_af_candidate *cand)
+{
+	struct si468x_rsq_status_report rsq;
+	int i, n = 0, checked = 0;
+
+	for (i = 0; i < nr_afs && checked < SI468X_AF_MAX_CHECKS; i++) {
+		if (afs[i] == cur)
+			continue;
+		checked++;
+
+		if (si468x_af_tune(core, afs[i]) < 0 ||
+		    si468x_af_measure(core, false, &rsq) < 0)
+			continue;
+		if (!rsq.valid || rsq.rssi < rssi + SI468X_AF_MIN_GAIN)
+			continue;
+
+		cand[n].freq = afs[i];
+		cand[n].rssi = rsq.rssi;
+		n++;
+	}
+	if (!checked)
+		return -ENOENT;
+	sort(cand, n, sizeof(*cand), si468x_af_cmp, NULL);
+
+	return n;
+}
+
+static void si468x_af_work(struct work_struct *work)
+{
+	struct si468x_core *core = container_of(to_delayed_work(work),
+						struct si468x_core,
+						af.work);
+	struct si468x_af_candidate cand[SI468X_AF_MAX_CHECKS];
+	struct si468x_rsq_status_report rsq;
+	u32 afs[SI468X_RDS_MAX_AFS], cur;
+	int nr_afs, n, i;
+	u16 pi;
+
+	si468x_core_lock(core);
+	if (!atomic_read(&core->is_alive) || !core->af.enabled ||
+	    !si468x_core_is_in_fm_receiver_mode(core) || core->scan.running)
+		goto unlock;
+
+	if (si468x_af_measure(core, true, &rsq) < 0 ||
+	    si468x_af_reception_ok(core, &rsq))
+		goto unlock;
+
+	pi = core->rds.pi;
+	nr_afs = core->rds.nr_afs;
+	memcpy(afs, core->rds.afs, nr_afs * sizeof(*afs));
+	/* FM frequencies are in units of 10 kHz */
+	cur = rsq.readfreq * 10;
+	n = -ENOENT;
+	if (pi)
+		n = si468x_af_candidates(core, cur, rsq.rssi, afs, nr_afs,
+					 cand);
+	if (n < 0) {
+		core->af.failures++;
+		goto unlock;
+	}
+
+	core->af.checks++;
+	for (i = 0; i < n; i++) {
+		if (si468x_af_tune(core, cand[i].freq) < 0 ||
+		    si468x_rds_wait_pi(core, SI468X_AF_PI_TIMEOUT) != pi)
+			continue;
+
+		dev_info(core->dev, "Switched PI 0x%04x from %u to %u kHz\n",
+			 pi, cur, cand[i].freq);
+		core->af.switches++;
+		goto flush;
+	}
+
+	/* nothing better, back to where we were */
+	if (si468x_af_tune(core, cur) < 0)
+		dev_warn(core->dev, "Could not tune back to %u kHz\n", cur);
+	core->af.returns++;
+	WRITE_ONCE(core->af.quiet_until,
+		   jiffies + msecs_to_jiffies(SI468X_AF_QUIET_TIME));
+flush:
+	si468x_rds_flush(core);
+unlock:
+	si468x_core_unlock(core);
+}
+
+/**
+ * si468x_af_degraded() - the chip signalled an RSQ interrupt
+ * @core: core device
+ *
+ * Called by the interrupt dispatcher. The interrupt stays pending until
+ * the work acknowledges it, so a scheduled check is not postponed.
+ * After a check that found nothing better the next one waits for
+ * SI468X_AF_QUIET_TIME ms, every check interrupts the audio.
+ */
+void si468x_af_degraded(struct si468x_core *core)
+{
+	unsigned long delay = msecs_to_jiffies(SI468X_AF_HOLDOFF);
+	unsigned long quiet_until = READ_ONCE(core->af.quiet_until);
+
+	if (!READ_ONCE(core->af.enabled))
+		return;
+
+	if (time_before(jiffies + delay, quiet_until))
+		delay = quiet_until - jiffies;
+	queue_delayed_work(system_wq, &core->af.work, delay);
+}
+
+/**
+ * si468x_core_set_fm_af() - configure alternative frequency switching
+ * @core:     core device, locked
+ * @enable:   retune to an AF when the reception degrades
+ * @rssi_low: RSSI in dBuV below which the reception is degraded
+ * @snr_low:  SNR in dB below which the reception is degraded
+ *
+ * The FM properties are written to the chip with the next power-up if
+ * it is not running in FM mode.
+ */
+int si468x_core_set_fm_af(struct si468x_core *core, bool enable,
+			  s8 rssi_low, s8 snr_low)
+{
+	u16 rsq = SI468X_PROP_FM_RSSILIEN | SI468X_PROP_FM_SNRLIEN;
+	int err;
+
+	err = regmap_write(core->regmap_fm,
+			   SI468X_PROP_FM_RSQ_RSSI_LOW_THRESHOLD,
+			   (u16)rssi_low);
+	if (err < 0)
+		return err;
+	err = regmap_write(core->regmap_fm,
+			   SI468X_PROP_FM_RSQ_SNR_LOW_THRESHOLD,
+			   (u16)snr_low);
+	if (err < 0)
+		return err;
+	err = regmap_update_bits(core->regmap_fm,
+				 SI468X_PROP_FM_RSQ_INTERRUPT_SOURCE,
+				 rsq, enable ? rsq : 0);
+	if (err < 0)
+		return err;
+
+	core->af.rssi_low = rssi_low;
+	core->af.snr_low = snr_low;
+	core->af.quiet_until = jiffies;
+	WRITE_ONCE(core->af.enabled, enable);
+	if (!enable)
+		cancel_delayed_work(&core->af.work);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(si468x_core_set_fm_af);
+
+/**
+ * si468x_af_show() - describe the state for debugfs
+ * @core: core device, locked
+ * @buf:  output buffer
+ * @size: size of @buf
+ */
+int si468x_af_show(struct si468x_core *core, char *buf, size_t size)
+{
+	struct si468x_af *af = &core->af;
+
+	return scnprintf(buf, size,
+			 "enabled %d rssi_low %d snr_low %d pi 0x%04x afs %d\n"
+			 "checks %u switches %u returns %u failures %u\n",
+			 af->enabled, af->rssi_low, af->snr_low, core->rds.pi,
+			 core->rds.nr_afs, af->checks, af->switches,
+			 af->returns, af->failures);
+}
+
+void si468x_af_init(struct si468x_core *core)
+{
+	core->af.rssi_low = SI468X_AF_RSSI_LOW_DEFAULT;
+	core->af.snr_low = SI468X_AF_SNR_LOW_DEFAULT;
+	core->af.quiet_until = jiffies;
+	INIT_DELAYED_WORK(&core->af.work, si468x_af_work);
+}
+
+void si468x_af_exit(struct si468x_core *core)
+{
+	cancel_delayed_work_sync(&core->af.work);
+}
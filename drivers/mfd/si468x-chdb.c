@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * drivers/mfd/si468x-chdb.c -- Channel database of si468x chips
+ *
+ * Copyright (C) 2020 HTL Steyr - Austria
+ * Copyright (C) 2020 Franz Parzer
+ *
+ * Author: Franz Parzer <rpi-receiver@htl-steyr.ac.at>
+ *
+ * Services are kept in a list in the order they were found and are
+ * indexed by a hash of (frequency, service id, subchannel). Writers
+ * are serialized by the core lock, readers only need
+ * rcu_read_lock(). Removed entries are freed after a grace period.
+ */
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/jhash.h>
+#include <linux/rculist.h>
+
+#include <linux/mfd/si468x-core.h>
+
+static struct kmem_cache *si468x_chdb_cache;
+
+static u32 si468x_chdb_key(u32 frequency, u32 service_id, u8 sub_ch_id)
+{
+	return jhash_3words(frequency, service_id, sub_ch_id, 0);
+}
+
+/**
+ * si468x_chdb_init() - initialize an empty channel database
+ * @db: channel database
+ */
+void si468x_chdb_init(struct si468x_chdb *db)
+{
+	INIT_LIST_HEAD(&db->list);
+	hash_init(db->index);
+	db->count = 0;
+	db->generation = 0;
+}
+EXPORT_SYMBOL_GPL(si468x_chdb_init);
+
+/**
+ * si468x_chdb_alloc() - allocate a zeroed channel entry
+ *
+ * The entry is not visible until it is passed to si468x_chdb_add() or
+ * si468x_chdb_replace(). Entries that never get there are released
+ * with si468x_chdb_free().
+ */
+struct si468x_dab_channel *si468x_chdb_alloc(void)
+{
+	return kmem_cache_zalloc(si468x_chdb_cache, GFP_KERNEL);
+}
+EXPORT_SYMBOL_GPL(si468x_chdb_alloc);
+
+/**
+ * si468x_chdb_free() - release an entry that was never added
+ * @channel: entry from si468x_chdb_alloc()
+ */
+void si468x_chdb_free(struct si468x_dab_channel *channel)
+{
+	kmem_cache_free(si468x_chdb_cache, channel);
+}
+EXPORT_SYMBOL_GPL(si468x_chdb_free);
+
+static void si468x_chdb_free_rcu(struct rcu_head *head)
+{
+	si468x_chdb_free(container_of(head, struct si468x_dab_channel, rcu));
+}
+
+/**
+ * si468x_chdb_add() - publish an entry at the end of the database
+ * @db:      channel database
+ * @channel: completely filled entry
+ */
+void si468x_chdb_add(struct si468x_chdb *db,
+		     struct si468x_dab_channel *channel)
+{
+	channel->generation = db->generation;
+	hash_add_rcu(db->index, &channel->node,
+		     si468x_chdb_key(channel->frequency, channel->service_id,
+				     channel->component_info.sub_ch_id));
+	list_add_tail_rcu(&channel->list, &db->list);
+	db->count++;
+}
+EXPORT_SYMBOL_GPL(si468x_chdb_add);
+
+/**
+ * si468x_chdb_replace() - swap an entry for an updated copy
+ * @db:  channel database
+ * @old: entry in @db
+ * @new: completely filled entry with the same key as @old
+ *
+ * Readers see either @old or @new, never neither. @new takes the
+ * position of @old in the list, @old is freed after a grace period.
+ */
+void si468x_chdb_replace(struct si468x_chdb *db,
+			 struct si468x_dab_channel *old,
+			 struct si468x_dab_channel *new)
+{
+	new->generation = db->generation;
+	hlist_replace_rcu(&old->node, &new->node);
+	list_replace_rcu(&old->list, &new->list);
+	call_rcu(&old->rcu, si468x_chdb_free_rcu);
+}
+EXPORT_SYMBOL_GPL(si468x_chdb_replace);
+
+/**
+ * si468x_chdb_del() - remove an entry
+ * @db:      channel database
+ * @channel: entry in @db, freed after a grace period
+ */
+void si468x_chdb_del(struct si468x_chdb *db,
+		     struct si468x_dab_channel *channel)
+{
+	hash_del_rcu(&channel->node);
+	list_del_rcu(&channel->list);
+	db->count--;
+	call_rcu(&channel->rcu, si468x_chdb_free_rcu);
+}
+EXPORT_SYMBOL_GPL(si468x_chdb_del);
+
+/**
+ * si468x_chdb_clear() - remove all entries
+ * @db: channel database
+ */
+void si468x_chdb_clear(struct si468x_chdb *db)
+{
+	struct si468x_dab_channel *ptr, *next;
+
+	list_for_each_entry_safe(ptr, next, &db->list, list)
+		si468x_chdb_del(db, ptr);
+}
+EXPORT_SYMBOL_GPL(si468x_chdb_clear);
+
+/**
+ * si468x_chdb_find() - look up a service
+ * @db:         channel database
+ * @frequency:  frequency of the ensemble in kHz
+ * @service_id: service id
+ * @sub_ch_id:  subchannel of the component
+ *
+ * The caller holds the core lock or rcu_read_lock().
+ *
+ * Returns the entry or NULL.
+ */
+struct si468x_dab_channel *si468x_chdb_find(struct si468x_chdb *db,
+					    u32 frequency, u32 service_id,
+					    u8 sub_ch_id)
+{
+	struct si468x_dab_channel *ptr;
+
+	hash_for_each_possible_rcu(db->index, ptr, node,
+				   si468x_chdb_key(frequency, service_id,
+						   sub_ch_id)) {
+		if (ptr->frequency == frequency &&
+		    ptr->service_id == service_id &&
+		    ptr->component_info.sub_ch_id == sub_ch_id)
+			return ptr;
+	}
+
+	return NULL;
+}
+EXPORT_SYMBOL_GPL(si468x_chdb_find);
+
+static int __init si468x_chdb_module_init(void)
+{
+	si468x_chdb_cache = KMEM_CACHE(si468x_dab_channel, 0);
+	if (!si468x_chdb_cache)
+		return -ENOMEM;
+
+	return 0;
+}
+module_init(si468x_chdb_module_init);
+
+static void __exit si468x_chdb_module_exit(void)
+{
+	/* wait for entries and MOT images still queued by call_rcu() */
+	rcu_barrier();
+	kmem_cache_destroy(si468x_chdb_cache);
+}
+module_exit(si468x_chdb_module_exit);
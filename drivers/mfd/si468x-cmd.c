@@ -21,9 +21,13 @@
 #include <linux/delay.h>
 #include <linux/atomic.h>
 #include <linux/device.h>
+#include <linux/debugfs.h>
 #include <linux/gpio.h>
 #include <linux/regulator/consumer.h>
 #include <linux/firmware.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/uaccess.h>
 #include <linux/videodev2.h>
 
 #include <linux/mfd/si468x-core.h>
@@ -31,32 +35,206 @@
 
 #include <asm/unaligned.h>
 
-static LIST_HEAD(si468x_dab_channel_list);
+#define CREATE_TRACE_POINTS
+#include "si468x-trace.h"
+
+const char * const si468x_func_string_table[] = {
+	[SI468X_FUNC_BOOTLOADER]   = "patch",
+	[SI468X_FUNC_AM_RECEIVER]  = "am",
+	[SI468X_FUNC_FM_RECEIVER]  = "fm",
+	[SI468X_FUNC_DAB_RECEIVER] = "dab",
+	[SI468X_FUNC_MINI_BOOT]    = "mini",
+};
+
+static inline void si468x_core_start_rds_drainer_once(struct si468x_core *);
+static inline void si468x_core_get_digital_service_list(struct si468x_core *);
+static inline void si468x_core_get_digital_service_data(struct si468x_core *);
 
 /**
- * si468x_core_get_and_signal_status() - IRQ dispatcher
+ * si468x_core_submit() - queue a request for the command dispatcher
  * @core: Core device structure
+ * @req: request, owned by the caller and must stay valid until its
+ * completion was called
  *
- * Dispatch the arrived interrupt request based on the value of the
- * status byte reported by the tuner.
+ * Returns false if @req is queued or running already.
+ */
+bool si468x_core_submit(struct si468x_core *core,
+			struct si468x_cmd_request *req)
+{
+	bool queued = false;
+
+	spin_lock(&core->cmd_queue_lock);
+	if (!req->queued) {
+		req->queued = true;
+		list_add_tail(&req->list, &core->cmd_queue[req->prio]);
+		queued = true;
+	}
+	spin_unlock(&core->cmd_queue_lock);
+
+	if (queued)
+		queue_work(core->cmd_wq, &core->cmd_dispatcher);
+
+	return queued;
+}
+EXPORT_SYMBOL_GPL(si468x_core_submit);
+
+/**
+ * si468x_core_register_notifier() - get enum si468x_core_event events
+ * @core: Core device structure
+ * @nb: notifier block of the cell
  *
+ * The callbacks run with the core lock held and must not take it.
  */
-void si468x_core_get_and_signal_status(struct si468x_core *core)
+int si468x_core_register_notifier(struct si468x_core *core,
+				  struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(&core->notifier, nb);
+}
+EXPORT_SYMBOL_GPL(si468x_core_register_notifier);
+
+int si468x_core_unregister_notifier(struct si468x_core *core,
+				    struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&core->notifier, nb);
+}
+EXPORT_SYMBOL_GPL(si468x_core_unregister_notifier);
+
+static struct si468x_cmd_request *
+si468x_core_next_request(struct si468x_core *core)
+{
+	struct si468x_cmd_request *req = NULL;
+	int prio;
+
+	spin_lock(&core->cmd_queue_lock);
+	for (prio = 0; prio < SI468X_PRIO_COUNT; prio++) {
+		req = list_first_entry_or_null(&core->cmd_queue[prio],
+					       struct si468x_cmd_request, list);
+		if (req) {
+			list_del_init(&req->list);
+			break;
+		}
+	}
+	spin_unlock(&core->cmd_queue_lock);
+
+	return req;
+}
+
+/**
+ * si468x_core_dispatch() - run the queued requests
+ * @work: cmd_dispatcher of the core
+ *
+ * Requests run one at a time in priority order, each with the core
+ * locked. Callers of si468x_core_lock() are let in between two
+ * requests, so an ioctl waits at most for one request.
+ */
+static void si468x_core_dispatch(struct work_struct *work)
+{
+	struct si468x_core *core = container_of(work, struct si468x_core,
+						cmd_dispatcher);
+	struct si468x_cmd_request *req;
+	int err;
+
+	for (;;) {
+		wait_event(core->cmd_lock_idle,
+			   !atomic_read(&core->cmd_lock_waiters));
+
+		req = si468x_core_next_request(core);
+		if (!req)
+			return;
+
+		mutex_lock(&core->cmd_lock);
+		err = req->fn(core, req);
+		mutex_unlock(&core->cmd_lock);
+
+		spin_lock(&core->cmd_queue_lock);
+		if (err == -EAGAIN) {
+			/* not done yet, let everything else queued run first */
+			list_add_tail(&req->list, &core->cmd_queue[req->prio]);
+			spin_unlock(&core->cmd_queue_lock);
+			continue;
+		}
+		req->queued = false;
+		spin_unlock(&core->cmd_queue_lock);
+
+		if (req->complete)
+			req->complete(core, req, err);
+	}
+}
+
+/**
+ * __si468x_core_read_reply() - send CMD_RD_REPLY and read the reply
+ * @core: Core device structure
+ * @buf:  buffer for the reply
+ * @len:  number of bytes to read
+ *
+ * Caller must hold @core->bus_lock.
+ *
+ * Returns the number of bytes read or a negative error code.
+ */
+static int __si468x_core_read_reply(struct si468x_core *core,
+				    u8 *buf, int len)
 {
 	int err;
 	char command = CMD_RD_REPLY;
-	char response[2];
-	/* NRESP is at least 4 -> always update Power State */
+
+	if (core->bus_ops->read_reply)
+		return core->bus_ops->read_reply(core, buf, len);
+
 	err = core->bus_ops->write(core, &command, sizeof(command));
 	if (err < 0) {
 		dev_err(core->dev, "Failed to send CMD_RD_REPLY %x\n", err);
-		return;
+		return err;
 	}
-	err = core->bus_ops->read(core, response, sizeof(response));
+
+	return core->bus_ops->read(core, buf, len);
+}
+
+static int si468x_core_read_reply(struct si468x_core *core, u8 *buf, int len)
+{
+	int err;
+
+	mutex_lock(&core->bus_lock);
+	err = __si468x_core_read_reply(core, buf, len);
+	mutex_unlock(&core->bus_lock);
+
+	return err;
+}
+
+/**
+ * si468x_core_get_and_signal_status() - IRQ dispatcher
+ * @core: Core device structure
+ *
+ * Dispatch the arrived interrupt request based on the value of the
+ * status byte reported by the tuner.
+ *
+ * If a command is pending, its whole reply is read into @core->reply
+ * and handed to the waiter, which then does not have to send
+ * CMD_RD_REPLY again.
+ */
+void si468x_core_get_and_signal_status(struct si468x_core *core)
+{
+	int err;
+	u8 response[2];
+
+	mutex_lock(&core->bus_lock);
+	/* NRESP is at least 4 -> always update Power State */
+	err = __si468x_core_read_reply(core, core->reply,
+				       max_t(int, core->reply_len,
+					     sizeof(response)));
 	if (err < 0) {
+		mutex_unlock(&core->bus_lock);
 		dev_err(core->dev, "Failed to get and signal status %x\n", err);
 		return;
 	}
+	memcpy(response, core->reply, sizeof(response));
+	if ((response[0] & SI468X_CTS) && core->reply_len) {
+		core->reply_read = err;
+		core->reply_len = 0;
+	}
+	mutex_unlock(&core->bus_lock);
+
+	trace_si468x_status(core->dev, response[0], response[1],
+			    core->chip_state);
 	if (response[0] & SI468X_CTS) {
 		/* Unfortunately completions could not be used for
 		 * signalling CTS since this flag cannot be cleared
@@ -80,6 +258,15 @@ void si468x_core_get_and_signal_status(struct si468x_core *core)
 		 * acquisition status has changed.
 		 * Service via the DAB_DIGRAD_STATUS commands */
 		dev_dbg(core->dev, "[interrupt] DACQ_INT\n");
+		si468x_follow_degraded(core);
+	}
+
+	if (response[0] & SI468X_RSQ_INT) {
+		/* Received signal quality interrupt indicator.
+		 * Indicates that an enabled RSQ threshold was crossed.
+		 * Service via the FM_RSQ_STATUS command */
+		dev_dbg(core->dev, "[interrupt] RSQ_INT\n");
+		si468x_af_degraded(core);
 	}
 
 	if (response[0] & SI468X_DSRV_INT) {
@@ -114,6 +301,68 @@ static irqreturn_t si468x_core_interrupt(int irq, void *dev)
 	return IRQ_HANDLED;
 }
 
+/**
+ * si468x_core_poll_status() - interrupt replacement
+ * @work: status_poll of the core
+ *
+ * Boards without interrupt line read the status periodically while
+ * the chip is running.
+ */
+static void si468x_core_poll_status(struct work_struct *work)
+{
+	struct si468x_core *core = container_of(to_delayed_work(work),
+						struct si468x_core,
+						status_poll);
+
+	if (!atomic_read(&core->is_alive))
+		return;
+
+	si468x_core_get_and_signal_status(core);
+
+	schedule_delayed_work(&core->status_poll,
+			      msecs_to_jiffies(SI468X_STATUS_POLL_INTERVAL));
+}
+
+/**
+ * si468x_core_zap_poll() - measure the latency of a DAB service change
+ * @work: zap_work of the core
+ *
+ * Polls DAB_GET_AUDIO_INFO until the chip reports an audio bit rate and
+ * records the time since the change was requested. Only scheduled while
+ * the debugfs file dab_zap is open.
+ */
+static void si468x_core_zap_poll(struct work_struct *work)
+{
+	struct si468x_core *core = container_of(to_delayed_work(work),
+						struct si468x_core,
+						zap_work);
+	struct si468x_dab_audio_info_report info;
+	s64 usecs;
+	int err;
+
+	si468x_core_lock(core);
+	if (!atomic_read(&core->is_alive) ||
+	    !si468x_core_is_in_dab_receiver_mode(core))
+		goto unlock;
+
+	err = si468x_core_cmd_dab_get_audio_info(core, &info);
+	usecs = ktime_us_delta(ktime_get(), core->zap_start);
+	if (!(err < 0) && info.bit_rate) {
+		core->zap_count++;
+		core->zap_last_us = usecs;
+		if (!core->zap_min_us || usecs < core->zap_min_us)
+			core->zap_min_us = usecs;
+		core->zap_max_us = max(core->zap_max_us, usecs);
+	} else if (usecs > SI468X_ZAP_TIMEOUT * USEC_PER_MSEC) {
+		core->zap_timeouts++;
+	} else {
+		schedule_delayed_work(&core->zap_work,
+				      msecs_to_jiffies(SI468X_ZAP_POLL_INTERVAL));
+	}
+unlock:
+	si468x_core_unlock(core);
+}
+
 static int si468x_core_parse_and_nag_about_error(struct si468x_core *core, u8 *buffer)
 {
 	int err;
@@ -233,6 +482,131 @@ static int si468x_core_parse_and_nag_about_error(struct si468x_core *core, u8 *b
 	return err;
 }
 
+/**
+ * si468x_core_check_reply() - evaluate the status bytes of a reply
+ * @core:    Core device structure
+ * @command: command id the reply belongs to
+ * @resp:    reply as read with CMD_RD_REPLY (at least 5 bytes)
+ * @len:     number of bytes read
+ *
+ * Updates the chip state and returns @len on success or a negative
+ * error code if the chip reported an error.
+ */
+static int si468x_core_check_reply(struct si468x_core *core,
+				   const u8 command, u8 resp[], int len)
+{
+	int err = len;
+
+	switch (resp[3] & SI468X_PUP_MASK) {
+	case SI468X_PUP_RESET:
+		core->chip_state = SI468X_STATE_WAITING_FOR_POWER_UP_CMD;
+		break;
+	case SI468X_PUP_RES:
+		core->chip_state = SI468X_STATE_RESERVED;
+		break;
+	case SI468X_PUP_BOOT:
+		core->chip_state = SI468X_STATE_BOOTLOADER_RUNNING;
+		break;
+	case SI468X_PUP_APP:
+		core->chip_state = SI468X_STATE_APPLICATION_RUNNING;
+		break;
+	}
+
+	if (resp[0] & SI468X_ERR) {
+		dev_err(core->dev,
+			"[CMD 0x%02x] Chip set error flag\n", command);
+		err = si468x_core_parse_and_nag_about_error(core, resp);
+		goto exit;
+	}
+
+	if (!(resp[0] & SI468X_CTS))
+		err = -EBUSY;
+exit:
+	return err;
+}
+
+/**
+ * si468x_core_poll_cts() - read the reply until the chip sets CTS
+ * @core:  Core device structure
+ * @resp:  buffer for the reply
+ * @respn: number of reply bytes to read
+ * @usecs: give up after this amount of time (in usecs)
+ *
+ * Returns the number of bytes read or a negative error code.
+ */
+static int si468x_core_poll_cts(struct si468x_core *core,
+				u8 resp[], const int respn, const int usecs)
+{
+	int err;
+	ktime_t timeout = ktime_add_us(ktime_get(), usecs);
+
+	for (;;) {
+		err = si468x_core_read_reply(core, resp, respn);
+		if (err < 0)
+			return err;
+		if (resp[0] & SI468X_CTS)
+			return err;
+		if (!ktime_before(ktime_get(), timeout))
+			return -ETIMEDOUT;
+		usleep_range(SI468X_POLL_INTERVAL, 2 * SI468X_POLL_INTERVAL);
+	}
+}
+
+/**
+ * si468x_core_wait_cts() - wait until the chip accepted a command
+ * @core:    Core device structure
+ * @command: command id, selects the policy in @core->cmd_stats
+ * @resp:    buffer for the reply
+ * @respn:   number of reply bytes to read
+ * @usecs:   maximum time to wait for CTS (in usecs)
+ *
+ * Commands with a poll budget poll the status for that long and only
+ * then fall back to waiting for the interrupt. Boards without interrupt
+ * line poll for the whole @usecs.
+ *
+ * Returns the number of reply bytes already read into @resp, 0 if the
+ * reply still has to be read or a negative error code.
+ */
+static int si468x_core_wait_cts(struct si468x_core *core, const u8 command,
+				u8 resp[], const int respn, const int usecs)
+{
+	struct si468x_cmd_stats *stats = &core->cmd_stats[command];
+	int budget;
+	int err;
+
+	if (core->irq)
+		budget = stats->poll_usecs;
+	else
+		budget = max_t(int, usecs, jiffies_to_usecs(1));
+
+	if (budget) {
+		err = si468x_core_poll_cts(core, resp, respn, budget);
+		if (err != -ETIMEDOUT) {
+			if (err >= 0)
+				stats->polled++;
+			return err;
+		}
+		stats->poll_timeouts++;
+		if (!core->irq)
+			goto timeout;
+	}
+
+	stats->irq_waits++;
+	if (wait_event_timeout(core->command,
+			       atomic_read(&core->cts),
+			       usecs_to_jiffies(usecs) + 1))
+		return 0;
+
+	si468x_core_get_and_signal_status(core);
+timeout:
+	/* chip does not respond with IRQ during power up and load */
+	if (!((usecs == SI468X_TIMEOUT_POWER_UP) || (usecs == SI468X_TIMEOUT_LOAD)))
+		dev_warn(core->dev,
+			 "(%s) [CMD 0x%02x] Answer timeout.\n",
+			 __func__, command);
+	return 0;
+}
+
 /**
  * si468x_core_send_command() - sends a command to si468x and waits its
  * response
@@ -259,8 +633,10 @@ static int si468x_core_send_command(struct si468x_core *core,
 				    const int usecs)
 {
 	int err;
-	char cmd_rd_reply = CMD_RD_REPLY;
 	u8  data[CMD_MAX_ARGS_COUNT + 1 + SI468X_MAX_HOST_LOAD_BYTES];
+	u8  status = 0, error = 0;
+	ktime_t start = 0;
+	s64 cts_us = 0;
 
 	if (core->power_state == SI468X_STATE_POWER_DOWN)
 		return -EIO;
@@ -275,7 +651,17 @@ static int si468x_core_send_command(struct si468x_core *core,
 	memcpy(&data[1], args, argn);
 
 	dev_dbg(core->dev, "Command:\n %*ph\n", argn + 1, data);
+	mutex_lock(&core->bus_lock);
 	err = core->bus_ops->write(core, (char *) data, argn + 1);
+	if (err == argn + 1) {
+		/* Set CTS to zero only after the command is send to avoid
+		 * possible racing conditions */
+		atomic_set(&core->cts, 0);
+		/* let the interrupt handler read the reply with the status */
+		core->reply_len = (respn <= SI468X_MAX_REPLY_BYTES) ? respn : 0;
+		core->reply_read = 0;
+	}
+	mutex_unlock(&core->bus_lock);
 	if (err != argn + 1) {
 		dev_err(core->dev,
 			"Error while sending command 0x%02x\n",
@@ -283,59 +669,124 @@ static int si468x_core_send_command(struct si468x_core *core,
 		err = (err >= 0) ? -EIO : err;
 		goto exit;
 	}
-	/* Set CTS to zero only after the command is send to avoid
-	 * possible racing conditions */
-	atomic_set(&core->cts, 0);
-
-	/* if (unlikely(command == CMD_POWER_DOWN) */
-	if (!wait_event_timeout(core->command,
-				atomic_read(&core->cts),
-				usecs_to_jiffies(usecs) + 1)) {
-	/* chip does not respond with IRQ during power up and load */
-		if (!((usecs == SI468X_TIMEOUT_POWER_UP) || (usecs == SI468X_TIMEOUT_LOAD)))
-			dev_warn(core->dev,
-				 "(%s) [CMD 0x%02x] Answer timeout.\n",
-				 __func__, command);
-		si468x_core_get_and_signal_status(core);
+	/* the clock is only read for the trace event */
+	if (trace_si468x_cmd_enabled())
+		start = ktime_get();
+
+	err = si468x_core_wait_cts(core, command, resp, respn, usecs);
+	if (start)
+		cts_us = ktime_us_delta(ktime_get(), start);
+
+	mutex_lock(&core->bus_lock);
+	if (!err && core->reply_read) {
+		err = core->reply_read;
+		memcpy(resp, core->reply, err);
 	}
+	core->reply_len = 0;
+	core->reply_read = 0;
+	mutex_unlock(&core->bus_lock);
 
-	err = core->bus_ops->write(core, &cmd_rd_reply, sizeof(cmd_rd_reply));
 	if (err < 0) {
-		dev_err(core->dev, "Failed to send CMD_RD_REPLY %x\n", err);
-		return err;
+		dev_err(core->dev, "Failed to poll reply %x\n", err);
+		goto exit;
 	}
 
-	err = core->bus_ops->read(core, resp, respn);
-	if (err < 0) {
-		dev_err(core->dev, "Failed to get reply %x\n", err);
-		return err;
+	if (!err) {
+		err = si468x_core_read_reply(core, resp, respn);
+		if (err < 0) {
+			dev_err(core->dev, "Failed to get reply %x\n", err);
+			goto exit;
+		}
 	}
 
-	switch (resp[3] & SI468X_PUP_MASK) {
-	case SI468X_PUP_RESET:
-		core->chip_state = SI468X_STATE_WAITING_FOR_POWER_UP_CMD;
-		break;
-	case SI468X_PUP_RES:
-		core->chip_state = SI468X_STATE_RESERVED;
-		break;
-	case SI468X_PUP_BOOT:
-		core->chip_state = SI468X_STATE_BOOTLOADER_RUNNING;
-		break;
-	case SI468X_PUP_APP:
-		core->chip_state = SI468X_STATE_APPLICATION_RUNNING;
-		break;
-	}
+	status = resp[0];
+	if ((status & SI468X_ERR) && respn > 4)
+		error = resp[4];
+	err = si468x_core_check_reply(core, command, resp, err);
+exit:
+	trace_si468x_cmd(core->dev, command, argn, respn, cts_us,
+			 status, error, core->chip_state, err);
+	return err;
+}
 
-	if (resp[0] & SI468X_ERR) {
+/**
+ * si468x_core_send_stream() - send a command followed by a data block
+ * @core:    Core device structure
+ * @command: command id
+ * @args:    command arguments
+ * @argn:    actual size of @args
+ * @data:    data appended to the arguments, sent without copying if
+ *           the bus supports it
+ * @len:     size of @data
+ * @resp:    buffer for the reply
+ * @respn:   actual size of @resp
+ * @usecs:   maximum time to poll for CTS (in usecs)
+ *
+ * Used for HOST_LOAD and flash commands. The chip does not raise an
+ * interrupt while the bootloader is running, so CTS is polled. @data
+ * may be NULL if @len is zero.
+ *
+ * Function returns the number of reply bytes on success and a negative
+ * error code on failure
+ */
+static int si468x_core_send_stream(struct si468x_core *core,
+				   const u8 command,
+				   const u8 args[], const int argn,
+				   const u8 *data, const int len,
+				   u8 resp[], const int respn,
+				   const int usecs)
+{
+	int err;
+	u8 *buf = core->load_buf;
+	u8 error = 0;
+	ktime_t start = 0;
+	s64 cts_us = 0;
+
+	if (core->power_state == SI468X_STATE_POWER_DOWN)
+		return -EIO;
+
+	if (argn + 1 > SI468X_LOAD_HDR_MAX || len > core->host_load_chunk)
+		return -EINVAL;
+
+	buf[0] = command;
+	memcpy(&buf[1], args, argn);
+
+	mutex_lock(&core->bus_lock);
+	err = -EOPNOTSUPP;
+	if (core->bus_ops->write_sg && len)
+		err = core->bus_ops->write_sg(core, buf, argn + 1, data, len);
+	if (err == -EOPNOTSUPP) {
+		if (len)
+			memcpy(&buf[argn + 1], data, len);
+		err = core->bus_ops->write(core, buf, argn + 1 + len);
+	}
+	mutex_unlock(&core->bus_lock);
+	if (err != argn + 1 + len) {
 		dev_err(core->dev,
-			"[CMD 0x%02x] Chip set error flag\n", command);
-		err = si468x_core_parse_and_nag_about_error(core, resp);
-		goto exit;
+			"Error while sending command 0x%02x\n",
+			command);
+		return (err >= 0) ? -EIO : err;
 	}
 
-	if (!(resp[0] & SI468X_CTS))
-		err = -EBUSY;
-exit:
+	if (trace_si468x_cmd_enabled())
+		start = ktime_get();
+	err = si468x_core_poll_cts(core, resp, respn, usecs);
+	if (start)
+		cts_us = ktime_us_delta(ktime_get(), start);
+	if (err < 0) {
+		dev_warn(core->dev,
+			 "(%s) [CMD 0x%02x] Answer timeout.\n",
+			 __func__, command);
+		trace_si468x_cmd(core->dev, command, argn + len, respn,
+				 cts_us, 0, 0, core->chip_state, err);
+		return err;
+	}
+
+	if ((resp[0] & SI468X_ERR) && respn > 4)
+		error = resp[4];
+	err = si468x_core_check_reply(core, command, resp, err);
+	trace_si468x_cmd(core->dev, command, argn + len, respn, cts_us,
+			 resp[0], error, core->chip_state, err);
 	return err;
 }
 
@@ -587,64 +1038,290 @@ static int si468x_cmd_set_nvm_parameters(struct si468x_core *core)
 }
 
 /**
- * si468x_cmd_load_firmware() - load firmware from file or flash to chip
+ * si468x_core_get_firmware() - get a firmware image from the core cache
  * @core: Core device structure
- * @fw_name: Firmware Filename
+ * @func: selects the image (as named by "firmware-<name>" in dt)
  *
+ * The first request of an image goes to the firmware loader, later
+ * requests are served from memory. The image stays pinned until the
+ * core is removed. Must be called with the core locked or before the
+ * core is in use.
+ *
+ * Returns the cached image, ERR_PTR(-ENOENT) if no file is named in dt
+ * or another ERR_PTR if the image could not be loaded.
  */
-static int si468x_cmd_load_firmware(struct si468x_core *core,
-					const u8 *of_shortname,
-					bool load_to)
+static struct si468x_fw_image *
+si468x_core_get_firmware(struct si468x_core *core, enum si468x_func func)
 {
-	const struct firmware *fw_entry = NULL;
-	u8  *fw_data = NULL;
-	int err, err_flash, err_fw, fw_len = 0;
+	struct si468x_fw_image *image = &core->fw_cache[func];
+	const struct firmware *fw;
 	const char *of_name, *fw_name;
-	u32 flash_base_address = 0, flash_address, size, crc;
-	u8       init_resp[CMD_LOAD_INIT_NRESP];
-	const u8 init_args[CMD_LOAD_INIT_NARGS] = {
-		0x00,
-	};
-	u8 load_resp[CMD_HOST_LOAD_NRESP];
-	u8 flash_resp[CMD_FLASH_LOAD_NRESP];
-	u8 args[max_t(int, CMD_FLASH_LOAD_NARGS + 5 + SI468X_MAX_HOST_LOAD_BYTES,
-			   CMD_HOST_LOAD_NARGS + 1 + SI468X_MAX_HOST_LOAD_BYTES)];
+	int err;
 
-	of_name = kasprintf(GFP_KERNEL, "flash-%s", of_shortname);
-	if (!of_name)
-		return -ENOMEM;
-	err_flash = device_property_read_u32(core->dev, of_name, &flash_base_address);
-	kfree(of_name);
-	flash_address = flash_base_address;
+	if (image->fw) {
+		atomic_inc(&core->fw_cache_hits);
+		return image;
+	}
 
-	of_name = kasprintf(GFP_KERNEL, "firmware-%s", of_shortname);
+	of_name = kasprintf(GFP_KERNEL, "firmware-%s",
+			    si468x_func_string_table[func]);
 	if (!of_name)
-		return -ENOMEM;
-	err_fw = device_property_read_string(core->dev, of_name, &fw_name);
+		return ERR_PTR(-ENOMEM);
+	err = device_property_read_string(core->dev, of_name, &fw_name);
 	kfree(of_name);
+	if (err)
+		return ERR_PTR(-ENOENT);
 
-	if (err_flash && err_fw) {
-		dev_err(core->dev, "No firmware found in dt\n");
-		return -ENODATA;
+	atomic_inc(&core->fw_cache_misses);
+	err = request_firmware(&fw, fw_name, core->dev);
+	if (err < 0) {
+		dev_err(core->dev,
+			"Unable to read firmware(%s) content\n",
+			fw_name);
+		return ERR_PTR(err);
+	}
+	if (!fw->size) {
+		dev_err(core->dev, "Firmware(%s) is empty\n", fw_name);
+		release_firmware(fw);
+		return ERR_PTR(-EINVAL);
 	}
-	
-	/* prefer firmware over flash load (e.g. to test new firmware) */
 
-	if (!err_fw) {
-		err = request_firmware(&fw_entry, fw_name, core->dev);
-		if (err < 0) {
-			dev_err(core->dev,
-				"Unable to read firmware(%s) content\n",
-				fw_name);
-			/* file does not exist and flash address not defined */
-			if (err_flash < 0)
-				return err;
-		} else {
-			dev_info(core->dev, "Firmware(%s) length : %zu bytes\n",
-				 fw_name, fw_entry->size);
-			fw_data = (void *)fw_entry->data;
-			fw_len = fw_entry->size;
+	image->fw = fw;
+	image->crc = crc32_be(0xFFFFFFFF, fw->data, fw->size);
+	dev_info(core->dev, "Firmware(%s) length : %zu bytes, crc 0x%08x\n",
+		 fw_name, fw->size, image->crc);
+
+	return image;
+}
+
+/**
+ * si468x_core_load_fw_cache() - load all firmware images named in dt
+ * @core: Core device structure
+ *
+ * Missing or broken images are not fatal here, they are reported again
+ * when the image is actually needed.
+ */
+static void si468x_core_load_fw_cache(struct si468x_core *core)
+{
+	int func;
+
+	for (func = 0; func < SI468X_FW_IMAGES; func++)
+		si468x_core_get_firmware(core, func);
+}
+
+/**
+ * si468x_core_release_fw_cache() - drop all cached firmware images
+ * @core: Core device structure
+ */
+static void si468x_core_release_fw_cache(struct si468x_core *core)
+{
+	int func;
+
+	for (func = 0; func < SI468X_FW_IMAGES; func++) {
+		release_firmware(core->fw_cache[func].fw);
+		core->fw_cache[func].fw = NULL;
+		core->fw_cache[func].in_nvm = false;
+		core->fw_cache[func].nvm_checked = false;
+	}
+}
+
+/**
+ * si468x_core_get_flash_address() - get the flash address of an image
+ * @core: Core device structure
+ * @func: selects the image (as named by "flash-<name>" in dt)
+ * @address: returns the address
+ *
+ * Returns 0 if an address is defined in dt, negative error otherwise.
+ */
+static int si468x_core_get_flash_address(struct si468x_core *core,
+					 enum si468x_func func, u32 *address)
+{
+	const char *of_name;
+	int err;
+
+	of_name = kasprintf(GFP_KERNEL, "flash-%s",
+			    si468x_func_string_table[func]);
+	if (!of_name)
+		return -ENOMEM;
+	err = device_property_read_u32(core->dev, of_name, address);
+	kfree(of_name);
+
+	return err;
+}
+
+/**
+ * si468x_cmd_check_nvm_crc() - let the chip verify an image in flash
+ * @core: Core device structure
+ * @crc: expected crc32 of the image
+ * @address: flash address of the image
+ * @size: size of the image
+ *
+ * Returns a negative error code if the flash content does not match.
+ */
+static int si468x_cmd_check_nvm_crc(struct si468x_core *core, u32 crc,
+				    u32 address, u32 size)
+{
+	u8       resp[CMD_FLASH_LOAD_NRESP];
+	const u8 args[CMD_FLASH_LOAD_NARGS + 4] = {
+		0x02, /* FLASH_CHECK_CRC32 sub command */
+		0x00,
+		0x00,
+		crc & 0xff,
+		(crc >> 8) & 0xff,
+		(crc >> 16) & 0xff,
+		(crc >> 24) & 0xff,
+		address & 0xff,
+		(address >> 8) & 0xff,
+		(address >> 16) & 0xff,
+		(address >> 24) & 0xff,
+		size & 0xff,
+		(size >> 8) & 0xff,
+		(size >> 16) & 0xff,
+		(size >> 24) & 0xff,
+	};
+
+	return si468x_core_send_stream(core, CMD_FLASH_LOAD,
+				       args, ARRAY_SIZE(args),
+				       NULL, 0,
+				       resp, ARRAY_SIZE(resp),
+				       SI468X_TIMEOUT_CRC);
+}
+
+/**
+ * si468x_core_nvm_yield() - let a core lock waiter preempt the mirror
+ * @core: Core device structure, locked
+ *
+ * Checked before every flash command. While the mirror runs, an open()
+ * or ioctl waiting for the core lock waits for one flash command only.
+ *
+ * Returns -EAGAIN if the mirror should give up the chip, else 0.
+ */
+static int si468x_core_nvm_yield(struct si468x_core *core)
+{
+	if (core->nvm_mirror_running && atomic_read(&core->cmd_lock_waiters))
+		return -EAGAIN;
+
+	return 0;
+}
+
+/**
+ * si468x_cmd_erase_nvm() - erase the flash sectors holding an image
+ * @core: Core device structure
+ * @address: flash address of the image
+ * @size: size of the image
+ */
+static int si468x_cmd_erase_nvm(struct si468x_core *core,
+				u32 address, u32 size)
+{
+	int err = 0;
+	u32 sector;
+	u8  resp[CMD_FLASH_LOAD_NRESP];
+	u8  args[7] = {
+		0xfe, /* FLASH_ERASE_SECTOR sub command */
+		0xc0,
+		0xde,
+	};
+
+	for (sector = round_down(address, SI468X_NVM_SECTOR_SIZE);
+	     sector < address + size;
+	     sector += SI468X_NVM_SECTOR_SIZE) {
+		args[3] = sector & 0xff;
+		args[4] = (sector >> 8) & 0xff;
+		args[5] = (sector >> 16) & 0xff;
+		args[6] = (sector >> 24) & 0xff;
+		err = si468x_core_nvm_yield(core);
+		if (err < 0)
+			break;
+		err = si468x_core_send_stream(core, CMD_FLASH_LOAD,
+					      args, ARRAY_SIZE(args),
+					      NULL, 0,
+					      resp, ARRAY_SIZE(resp),
+					      SI468X_TIMEOUT_ERASE);
+		if (err < 0) {
+			dev_err(core->dev,
+				"Failed to erase nvram sector 0x%08x\n",
+				sector);
+			break;
+		}
+	}
+
+	return err;
+}
+
+/**
+ * si468x_cmd_load_firmware() - load firmware from file or flash to chip
+ * @core: Core device structure
+ * @func: selects the image to load
+ * @load_to: load to chip ram or write to flash
+ *
+ */
+static int si468x_cmd_load_firmware(struct si468x_core *core,
+				    enum si468x_func func,
+				    bool load_to)
+{
+	struct si468x_fw_image *image;
+	const u8 *fw_data = NULL;
+	int err, err_flash, fw_len = 0;
+	u32 flash_base_address = 0, flash_address, size;
+	u8       init_resp[CMD_LOAD_INIT_NRESP];
+	const u8 init_args[CMD_LOAD_INIT_NARGS] = {
+		0x00,
+	};
+	u8 load_resp[CMD_HOST_LOAD_NRESP];
+	u8 flash_resp[CMD_FLASH_LOAD_NRESP];
+	u8 args[CMD_FLASH_LOAD_NARGS + 4];
+
+	err_flash = si468x_core_get_flash_address(core, func,
+						  &flash_base_address);
+	if (err_flash == -ENOMEM)
+		return err_flash;
+	flash_address = flash_base_address;
+
+	/* prefer firmware over flash load (e.g. to test new firmware) */
+	image = si468x_core_get_firmware(core, func);
+	if (IS_ERR(image)) {
+		err = PTR_ERR(image);
+		if (err_flash) {
+			/* file does not exist and flash address not defined */
+			if (err == -ENOENT) {
+				dev_err(core->dev, "No firmware found in dt\n");
+				err = -ENODATA;
+			}
+			return err;
+		}
+		image = NULL;
+	}
+
+	/*
+	 * In auto mirror mode the file is only loaded until the same image
+	 * has been written to flash, afterwards the flash copy is booted.
+	 * Flash commands need the patch, so the patch itself is excluded.
+	 */
+	if (image && !err_flash && core->fw_auto_mirror &&
+	    load_to == SI468X_LOAD_TO_HOST &&
+	    func > SI468X_FUNC_BOOTLOADER) {
+		if (!image->nvm_checked) {
+			image->nvm_checked = true;
+			err = si468x_cmd_set_nvm_parameters(core);
+			if (err < 0)
+				return err;
+			err = si468x_cmd_check_nvm_crc(core, image->crc,
+						       flash_base_address,
+						       image->fw->size);
+			image->in_nvm = !(err < 0);
 		}
+		if (image->in_nvm) {
+			image = NULL;
+		} else {
+			dev_info(core->dev, "%s is not in nvram, mirroring\n",
+				 si468x_func_string_table[func]);
+			core->nvm_mirror_pending |= BIT(func);
+		}
+	}
+
+	if (image) {
+		fw_data = image->fw->data;
+		fw_len = image->fw->size;
 	}
 
 	if (load_to == SI468X_LOAD_TO_HOST) {
@@ -656,27 +1333,30 @@ static int si468x_cmd_load_firmware(struct si468x_core *core,
 			goto exit;
 	}
 
-	if ((load_to == SI468X_LOAD_TO_FLASH) || (!fw_entry)) {
+	if ((load_to == SI468X_LOAD_TO_FLASH) || (!image)) {
 		err = si468x_cmd_set_nvm_parameters(core);
 		if (err < 0)
 			goto exit;
 	}
 
-	if (fw_entry) {
-		while (fw_data && fw_len > 0) {
-			size = min_t(int, fw_len, SI468X_MAX_HOST_LOAD_BYTES);
-			memset(args, 0, ARRAY_SIZE(args));
+	if (image) {
+		while (fw_len > 0) {
 			if (load_to == SI468X_LOAD_TO_HOST) {
-				memcpy(args + CMD_HOST_LOAD_NARGS, fw_data, size);
-				dev_dbg_ratelimited(core->dev, "HOST load: %*ph\n",
-						     CMD_HOST_LOAD_NARGS + 4, args);
-				err = si468x_core_send_command(core, CMD_HOST_LOAD,
-					       args, CMD_HOST_LOAD_NARGS + size,
+				size = min_t(int, fw_len, core->host_load_chunk);
+				memset(args, 0, CMD_HOST_LOAD_NARGS);
+				err = si468x_core_send_stream(core, CMD_HOST_LOAD,
+					       args, CMD_HOST_LOAD_NARGS,
+					       fw_data, size,
 					       load_resp, ARRAY_SIZE(load_resp),
-					       SI468X_TIMEOUT_LOAD);
+					       SI468X_DEFAULT_TIMEOUT);
 			} else {
-				memcpy(args + CMD_FLASH_LOAD_NARGS + 4, fw_data, size); /* SUBCMD1..3 */
-				args[0] = 0xf0;
+				size = min_t(int, fw_len,
+					     min_t(int, core->host_load_chunk,
+						   SI468X_MAX_HOST_LOAD_BYTES));
+				err = si468x_core_nvm_yield(core);
+				if (err < 0)
+					goto exit;
+				args[0] = 0xf0; /* SUBCMD1..3 */
 				args[1] = 0x0c;
 				args[2] = 0xed;
 				args[3] = 0x00;
@@ -693,43 +1373,30 @@ static int si468x_cmd_load_firmware(struct si468x_core *core,
 				args[14] = (cpu_to_le32(size) >> 24) & 0xff;
 				dev_dbg_ratelimited(core->dev, "FLASH load: %*ph\n",
 						     CMD_FLASH_LOAD_NARGS + 4, args);
-				err = si468x_core_send_command(core, CMD_FLASH_LOAD,
-					       args, CMD_FLASH_LOAD_NARGS + 4 + size,
+				err = si468x_core_send_stream(core, CMD_FLASH_LOAD,
+					       args, CMD_FLASH_LOAD_NARGS + 4,
+					       fw_data, size,
 					       flash_resp, ARRAY_SIZE(flash_resp),
 					       SI468X_DEFAULT_TIMEOUT);
-				flash_address += SI468X_MAX_HOST_LOAD_BYTES;
+				flash_address += size;
 			}
 			if (err < 0)
 				goto exit;
 
-			fw_data += SI468X_MAX_HOST_LOAD_BYTES;
-			fw_len -= SI468X_MAX_HOST_LOAD_BYTES;
+			fw_data += size;
+			fw_len -= size;
 		}
 		if (load_to == SI468X_LOAD_TO_FLASH) {
-			crc = crc32_be(0xFFFFFFFF, fw_entry->data, fw_entry->size);
-			args[0] = 0x02;
-			args[1] = 0x00;
-			args[2] = 0x00;
-			args[3] = cpu_to_le32(crc) & 0xff;
-			args[4] = (cpu_to_le32(crc) >> 8) & 0xff;
-			args[5] = (cpu_to_le32(crc) >> 16) & 0xff;
-			args[6] = (cpu_to_le32(crc) >> 24) & 0xff;
-			args[7] = cpu_to_le32(flash_base_address) & 0xff;
-			args[8] = (cpu_to_le32(flash_base_address) >> 8) & 0xff;
-			args[9] = (cpu_to_le32(flash_base_address) >> 16) & 0xff;
-			args[10] = (cpu_to_le32(flash_base_address) >> 24) & 0xff;
-			args[11] = cpu_to_le32(fw_entry->size) & 0xff;
-			args[12] = (cpu_to_le32(fw_entry->size) >> 8) & 0xff;
-			args[13] = (cpu_to_le32(fw_entry->size) >> 16) & 0xff;
-			args[14] = (cpu_to_le32(fw_entry->size) >> 24) & 0xff;
-			err = si468x_core_send_command(core, CMD_FLASH_LOAD,
-					args, CMD_FLASH_LOAD_NARGS + 4,
-					flash_resp, ARRAY_SIZE(flash_resp),
-					SI468X_TIMEOUT_CRC);
+			err = si468x_cmd_check_nvm_crc(core, image->crc,
+						       flash_base_address,
+						       image->fw->size);
 			if (err < 0) {
 				dev_err(core->dev, "FLASH load: CRC Error 0x%08x\n", err);
+				image->in_nvm = false;
 				goto exit;
 			}
+			image->in_nvm = true;
+			image->nvm_checked = true;
 		}
 	} else {
 		if (!err_flash) {
@@ -738,7 +1405,8 @@ static int si468x_cmd_load_firmware(struct si468x_core *core,
 			args[4] = (cpu_to_le32(flash_base_address) >> 8) & 0xff;
 			args[5] = (cpu_to_le32(flash_base_address) >> 16) & 0xff;
 			args[6] = (cpu_to_le32(flash_base_address) >> 24) & 0xff;
-			dev_info(core->dev, "FLASH load: %s\n", of_shortname);
+			dev_info(core->dev, "FLASH load: %s\n",
+				 si468x_func_string_table[func]);
 			err = si468x_core_send_command(core, CMD_FLASH_LOAD,
 				       args, CMD_FLASH_LOAD_NARGS,
 				       flash_resp, ARRAY_SIZE(flash_resp),
@@ -746,10 +1414,90 @@ static int si468x_cmd_load_firmware(struct si468x_core *core,
 		}
 	}
 exit:
-	release_firmware(fw_entry);
 	return err;
 }
 
+/**
+ * si468x_core_mirror_nvm() - write host loaded images to flash
+ * @work: nvm_mirror_work of the core
+ *
+ * Runs while the chip is idle. Every image that had to be loaded from
+ * the host is written to its flash address, so the next boot can use
+ * the flash copy. The mirror gives way before the next flash command
+ * once somebody waits for the core lock, the rest is written after the
+ * next power down.
+ */
+static void si468x_core_mirror_nvm(struct work_struct *work)
+{
+	struct si468x_core *core = container_of(work, struct si468x_core,
+						nvm_mirror_work);
+	enum si468x_func func, saved_func;
+	struct si468x_fw_image *image;
+	unsigned long retry = 0;
+	u32 address;
+	int err;
+
+	si468x_core_lock(core);
+	if (core->power_state != SI468X_STATE_POWER_DOWN ||
+	    !core->nvm_mirror_pending)
+		goto exit;
+
+	saved_func = core->power_up_parameters.func;
+	core->power_up_parameters.func = SI468X_FUNC_BOOTLOADER;
+	err = si473x_core_set_power_state(core, SI468X_STATE_POWER_UP);
+	if (err < 0)
+		goto restore;
+
+	err = si468x_cmd_set_nvm_parameters(core);
+	if (err < 0)
+		goto powerdown;
+
+	core->nvm_mirror_running = true;
+	for (func = SI468X_FUNC_AM_RECEIVER; func < SI468X_FW_IMAGES; func++) {
+		if (!(core->nvm_mirror_pending & BIT(func)))
+			continue;
+		/* never retry a failed image, it would run on every power down */
+		core->nvm_mirror_pending &= ~BIT(func);
+
+		image = &core->fw_cache[func];
+		if (!image->fw ||
+		    si468x_core_get_flash_address(core, func, &address))
+			continue;
+
+		err = si468x_cmd_check_nvm_crc(core, image->crc, address,
+					       image->fw->size);
+		if (err >= 0) {
+			image->in_nvm = true;
+			continue;
+		}
+
+		dev_info(core->dev, "Mirroring %s to nvram at 0x%08x\n",
+			 si468x_func_string_table[func], address);
+		err = si468x_cmd_erase_nvm(core, address, image->fw->size);
+		if (!(err < 0))
+			err = si468x_cmd_load_firmware(core, func,
+						       SI468X_LOAD_TO_FLASH);
+		if (err == -EAGAIN) {
+			retry = core->nvm_mirror_pending | BIT(func);
+			break;
+		}
+		if (err < 0)
+			dev_err(core->dev, "Failed to mirror %s (err = %d)\n",
+				si468x_func_string_table[func], err);
+	}
+	core->nvm_mirror_running = false;
+
+powerdown:
+	/* the power down must not schedule the mirror again */
+	core->nvm_mirror_pending = 0;
+	si473x_core_set_power_state(core, SI468X_STATE_POWER_DOWN);
+	core->nvm_mirror_pending = retry;
+restore:
+	core->power_up_parameters.func = saved_func;
+exit:
+	si468x_core_unlock(core);
+}
+
 /**
  * si468x_core_select_func() - boot chip with propper firmware
  * @core: Core device structure
@@ -767,7 +1515,8 @@ int si468x_core_select_func(struct si468x_core *core, enum si468x_func func)
 	if (func == SI468X_FUNC_MINI_BOOT)
 		return 0;
 
-	err = si468x_cmd_load_firmware(core, "patch", SI468X_LOAD_TO_HOST);
+	err = si468x_cmd_load_firmware(core, SI468X_FUNC_BOOTLOADER,
+				       SI468X_LOAD_TO_HOST);
 	if (err < 0) {
 		dev_err(core->dev,
 			"Failed to download patch"
@@ -781,8 +1530,7 @@ int si468x_core_select_func(struct si468x_core *core, enum si468x_func func)
 		return 0;
 	}
 
-	err = si468x_cmd_load_firmware(core, si468x_func_string_table[func],
-				       SI468X_LOAD_TO_HOST);
+	err = si468x_cmd_load_firmware(core, func, SI468X_LOAD_TO_HOST);
 	if (err < 0) {
 		dev_err(core->dev,
 			"Failed to download %s"
@@ -870,7 +1618,8 @@ int si468x_core_start(struct si468x_core *core)
 
 	msleep(3); /* RSTB rise to start of POWER_UP Command */
 
-	enable_irq(core->irq);
+	if (core->irq)
+		enable_irq(core->irq);
 
 	err = si468x_core_send_command(core, CMD_POWER_UP,
 				       power_up_args, ARRAY_SIZE(power_up_args),
@@ -887,8 +1636,7 @@ int si468x_core_start(struct si468x_core *core)
 		goto disable_irq;
 	}
 
-	err = si468x_cmd_load_firmware(core,
-				       si468x_func_string_table[SI468X_FUNC_MINI_BOOT],
+	err = si468x_cmd_load_firmware(core, SI468X_FUNC_MINI_BOOT,
 				       SI468X_LOAD_TO_HOST);
 	if (err < 0) {
 		dev_err(core->dev,
@@ -908,13 +1656,18 @@ int si468x_core_start(struct si468x_core *core)
 
 	atomic_set(&core->is_alive, 1);
 
+	if (!core->irq)
+		schedule_delayed_work(&core->status_poll,
+			msecs_to_jiffies(SI468X_STATUS_POLL_INTERVAL));
+
 	return 0;
 
 disable_irq:
 	if (err == -ENODEV)
 		atomic_set(&core->is_alive, 0);
 
-	disable_irq(core->irq);
+	if (core->irq)
+		disable_irq(core->irq);
 
 	gpiod_set_value_cansleep(core->gpio_reset, 1);
 
@@ -944,8 +1697,17 @@ void si468x_core_stop(struct si468x_core *core)
 		regcache_cache_only(core->regmap_dab, true);
 
 	atomic_set(&core->is_alive, 0);
-
-	disable_irq(core->irq);
+	core->dab_tuned_index = -1;
+	/* the core lock may be held, the works check is_alive */
+	cancel_delayed_work(&core->zap_work);
+	cancel_delayed_work(&core->follow.work);
+	cancel_delayed_work(&core->af.work);
+	si468x_rds_reset(core);
+
+	if (core->irq)
+		disable_irq(core->irq);
+	else
+		cancel_delayed_work_sync(&core->status_poll);
 
 	gpiod_set_value_cansleep(core->gpio_reset, 1);
 	return;
@@ -1035,8 +1797,12 @@ int si473x_core_set_power_state(struct si468x_core *core,
 disable_regulators:
 			err = regulator_bulk_disable(ARRAY_SIZE(core->supplies),
 						     core->supplies);
-			if (err < 0)
+			if (err < 0) {
 				core->power_state = SI468X_STATE_POWER_INCONSISTENT;
+				break;
+			}
+			if (core->nvm_mirror_pending)
+				schedule_work(&core->nvm_mirror_work);
 			break;
 		default:
 			break;
@@ -1110,75 +1876,259 @@ bool si468x_core_is_in_dab_receiver_mode(struct si468x_core *core)
 EXPORT_SYMBOL_GPL(si468x_core_is_in_dab_receiver_mode);
 
 /**
- * si468x_core_report_drainer_stop() - mark the completion of the RDS
- * buffer drain porcess by the worker.
+ * si468x_core_start_rds_drainer_once() - queue the RDS drainer if it
+ * is not queued or running already
  *
- * @core: Core device structure
+ * @core: Datastructure corresponding to the chip.
  */
-static inline void si468x_core_report_drainer_stop(struct si468x_core *core)
+static inline void si468x_core_start_rds_drainer_once(struct si468x_core *core)
+{
+	si468x_core_submit(core, &core->rds_drain_req);
+}
+
+static int si468x_core_rds_target_depth(struct si468x_core *core)
+{
+	u64 groups;
+
+	/* nobody reads the groups, take as few interrupts as possible */
+	if (time_after(jiffies, READ_ONCE(core->rds_last_read) +
+		       msecs_to_jiffies(SI468X_RDS_IDLE_TIME)))
+		return SI468X_RDS_MAX_FIFO_COUNT;
+
+	groups = div_u64((u64)core->rds_rate * core->rds_latency_ms, 1000000);
+
+	return clamp_t(int, groups, 1, SI468X_RDS_MAX_FIFO_COUNT);
+}
+
+static int si468x_core_write_rds_depth(struct si468x_core *core, int depth)
 {
-	mutex_lock(&core->rds_drainer_status_lock);
-	core->rds_drainer_is_working = false;
-	mutex_unlock(&core->rds_drainer_status_lock);
+	int err;
+
+	if (depth == core->rds_fifo_depth)
+		return 0;
+
+	if (si468x_core_is_in_fm_receiver_mode(core)) {
+		err = regmap_write(core->regmap_fm,
+				   SI468X_PROP_FM_RDS_INTERRUPT_FIFO_COUNT,
+				   depth);
+		if (err < 0)
+			return err;
+	}
+	core->rds_fifo_depth = depth;
+
+	return 0;
 }
 
 /**
- * si468x_core_start_rds_drainer_once() - start RDS drainer worker if
- * there is none working, do nothing otherwise
+ * si468x_core_rds_coalesce() - adapt the RDS interrupt threshold
+ * @core: Core device structure
+ * @used: groups in the chip FIFO when the interrupt is drained
  *
- * @core: Datastructure corresponding to the chip.
+ * The groups that arrived since the last interrupt give the group rate,
+ * the FIFO count is set to the groups received within the latency
+ * target. Lowering it takes effect at once, raising it needs a
+ * difference of SI468X_RDS_COUNT_HYSTERESIS groups.
  */
-static inline void si468x_core_start_rds_drainer_once(struct si468x_core *core)
+static int si468x_core_rds_coalesce(struct si468x_core *core, int used)
 {
-	mutex_lock(&core->rds_drainer_status_lock);
-	if (!core->rds_drainer_is_working) {
-		core->rds_drainer_is_working = true;
-		schedule_work(&core->rds_fifo_drainer);
+	ktime_t now = ktime_get();
+	s64 usecs, rate;
+	int depth;
+
+	core->rds_interrupts++;
+	usecs = ktime_us_delta(now, core->rds_last_drain);
+	if (ktime_to_ns(core->rds_last_drain) && used > 0 && usecs > 0) {
+		rate = div64_s64((s64)used * 1000000000, usecs);
+		rate = min_t(s64, rate, 4 * SI468X_RDS_NOMINAL_RATE);
+		/* moving average, a quarter of the new sample */
+		core->rds_rate = (3 * core->rds_rate + rate) / 4;
 	}
-	mutex_unlock(&core->rds_drainer_status_lock);
+	core->rds_last_drain = now;
+
+	depth = si468x_core_rds_target_depth(core);
+	if (depth > core->rds_fifo_depth &&
+	    depth < core->rds_fifo_depth + SI468X_RDS_COUNT_HYSTERESIS)
+		return 0;
+	if (depth != core->rds_fifo_depth)
+		core->rds_depth_changes++;
+
+	return si468x_core_write_rds_depth(core, depth);
 }
 
 /**
- * si468x_drain_rds_fifo() - RDS buffer drainer.
- * @work: struct work_struct being passed to the function by the
- * kernel.
+ * si468x_core_reset_rds_rate() - start the RDS group rate estimate anew
+ * @core: Core device structure
  *
- * Drain the contents of the RDS FIFO of
+ * Called when RDS is enabled, the rate is assumed to be the nominal one
+ * until the first interrupt. The FIFO count to write is left in
+ * core->rds_fifo_depth.
  */
-void si468x_core_drain_rds_fifo(struct work_struct *work)
+void si468x_core_reset_rds_rate(struct si468x_core *core)
 {
-	int err;
+	core->rds_rate = SI468X_RDS_NOMINAL_RATE;
+	core->rds_last_drain = 0;
+	core->rds_fifo_depth = si468x_core_rds_target_depth(core);
+}
+EXPORT_SYMBOL_GPL(si468x_core_reset_rds_rate);
 
-	struct si468x_core *core = container_of(work, struct si468x_core,
-						rds_fifo_drainer);
+/**
+ * si468x_core_set_rds_latency() - set the RDS latency target
+ * @core:  Core device structure, locked
+ * @msecs: longest time a group may wait in the chip FIFO
+ *
+ * A group is delivered at the latest after @msecs at the average group
+ * rate, 0 requests an interrupt for every group.
+ */
+int si468x_core_set_rds_latency(struct si468x_core *core, u32 msecs)
+{
+	core->rds_latency_ms = msecs;
+
+	return si468x_core_write_rds_depth(core,
+					   si468x_core_rds_target_depth(core));
+}
+EXPORT_SYMBOL_GPL(si468x_core_set_rds_latency);
+
+static void si468x_core_rds_ring_add(struct si468x_core *core,
+				     const struct v4l2_rds_data *group)
+{
+	int i;
+
+	spin_lock(&core->rds_ring_lock);
+	for (i = 0; i < 4; i++)
+		core->rds_ring[core->rds_head++ & (SI468X_RDS_RING_BLOCKS - 1)] =
+			group[i];
+	spin_unlock(&core->rds_ring_lock);
+}
+
+/**
+ * si468x_core_rds_cursor() - cursor of a new RDS reader
+ * @core: Core device structure
+ *
+ * A new reader starts with the next block received.
+ */
+u32 si468x_core_rds_cursor(struct si468x_core *core)
+{
+	u32 head;
+
+	spin_lock(&core->rds_ring_lock);
+	head = core->rds_head;
+	spin_unlock(&core->rds_ring_lock);
+
+	return head;
+}
+EXPORT_SYMBOL_GPL(si468x_core_rds_cursor);
+
+/**
+ * si468x_core_rds_pending() - check for RDS blocks after a cursor
+ * @core:   Core device structure
+ * @cursor: cursor of the reader
+ */
+bool si468x_core_rds_pending(struct si468x_core *core, u32 cursor)
+{
+	return READ_ONCE(core->rds_head) != cursor;
+}
+EXPORT_SYMBOL_GPL(si468x_core_rds_pending);
+
+/**
+ * si468x_core_read_rds_blocks() - copy RDS blocks of a reader
+ * @core:   Core device structure
+ * @cursor: cursor of the reader, advanced by the blocks copied
+ * @blocks: receives the blocks
+ * @max:    size of @blocks
+ *
+ * The ring is shared by all readers, the writer never waits for them.
+ * A reader that fell behind by more than SI468X_RDS_RING_BLOCKS blocks
+ * gets a block with V4L2_RDS_BLOCK_INVALID | V4L2_RDS_BLOCK_ERROR
+ * first and continues with the oldest group in the ring.
+ *
+ * Function returns the number of blocks copied.
+ */
+int si468x_core_read_rds_blocks(struct si468x_core *core, u32 *cursor,
+				struct v4l2_rds_data *blocks, int max)
+{
+	u32 tail = *cursor, lost;
+	int n = 0;
+
+	if (max <= 0)
+		return 0;
+
+	spin_lock(&core->rds_ring_lock);
+	if (core->rds_head - tail > SI468X_RDS_RING_BLOCKS) {
+		lost = core->rds_head - SI468X_RDS_RING_BLOCKS - tail;
+		core->rds_overruns += lost;
+		tail = core->rds_head - SI468X_RDS_RING_BLOCKS;
+		blocks[0].lsb = 0;
+		blocks[0].msb = 0;
+		blocks[0].block = V4L2_RDS_BLOCK_INVALID | V4L2_RDS_BLOCK_ERROR;
+		n = 1;
+	}
+	while (n < max && tail != core->rds_head)
+		blocks[n++] = core->rds_ring[tail++ &
+					     (SI468X_RDS_RING_BLOCKS - 1)];
+	spin_unlock(&core->rds_ring_lock);
+
+	*cursor = tail;
+	WRITE_ONCE(core->rds_last_read, jiffies);
 
+	return n;
+}
+EXPORT_SYMBOL_GPL(si468x_core_read_rds_blocks);
+
+/**
+ * si468x_core_drain_rds_fifo() - RDS buffer drainer.
+ * @core: Core device structure
+ * @req: the drainer request
+ *
+ * Drain the contents of the RDS FIFO in batches of
+ * SI468X_RDS_DRAIN_BATCH groups, other requests may run in between.
+ */
+static int si468x_core_drain_rds_fifo(struct si468x_core *core,
+				      struct si468x_cmd_request *req)
+{
+	int err, i;
 	struct si468x_rds_status_report report;
 
-	si468x_core_lock(core);
+	/* the groups belong to a station the band scan is looking at */
+	if (core->scan.running) {
+		si468x_rds_flush(core);
+		return 0;
+	}
 
-	err = si468x_core_cmd_fm_rds_status(core, true, false, false, &report);
-	if (!(err < 0)) {
-		int i = report.rdsfifoused;
+	if (!core->rds_drain_left) {
+		err = si468x_core_cmd_fm_rds_status(core, true, false, false,
+						    &report);
+		if (err < 0)
+			return err;
+		core->rds_drain_left = report.rdsfifoused;
 		dev_dbg(core->dev,
-			"%d elements in RDS FIFO. Draining.\n", i);
-		for (; i > 0; --i) {
-			err = si468x_core_cmd_fm_rds_status(core, false, false,
-							    (i == 1), &report);
-			if (err < 0)
-				goto unlock;
+			"%d elements in RDS FIFO. Draining.\n",
+			core->rds_drain_left);
+
+		err = si468x_core_rds_coalesce(core, report.rdsfifoused);
+		if (err < 0)
+			dev_warn(core->dev,
+				 "Could not adapt the RDS FIFO count (%d)\n",
+				 err);
+	}
 
-			kfifo_in(&core->rds_fifo, report.rds,
-				 sizeof(report.rds));
-			dev_dbg(core->dev, "RDS data:\n %*ph\n",
-				(int)sizeof(report.rds), report.rds);
+	for (i = 0; i < SI468X_RDS_DRAIN_BATCH && core->rds_drain_left > 0; i++) {
+		err = si468x_core_cmd_fm_rds_status(core, false, false,
+						    (core->rds_drain_left == 1),
+						    &report);
+		if (err < 0) {
+			core->rds_drain_left = 0;
+			return err;
 		}
-		dev_dbg(core->dev, "Drrrrained!\n");
-		wake_up_interruptible(&core->rds_read_queue);
+		core->rds_drain_left--;
+
+		si468x_core_rds_ring_add(core, report.rds);
+		dev_dbg(core->dev, "RDS data:\n %*ph\n",
+			(int)sizeof(report.rds), report.rds);
+		si468x_rds_receive(core, &report);
 	}
+	wake_up_interruptible(&core->rds_read_queue);
 
-unlock:
-	si468x_core_unlock(core);
-	si468x_core_report_drainer_stop(core);
+	return core->rds_drain_left ? -EAGAIN : 0;
 }
 
 int si468x_core_cmd_dab_start_service(struct si468x_core *core,
@@ -1230,10 +2180,15 @@ int si468x_core_cmd_dab_start_service(struct si468x_core *core,
 		args[6] = channel->extended_country_code;
 	}
 
-	err = si468x_core_cmd_dab_rsq_status(core, &rsq_args, &rsq_report);
-	if (err < 0)
-		return err;
-	if (channel->frequency_index != rsq_report.tune_index) {
+	/* the tuned index is tracked, only ask the chip if it is unknown */
+	if (core->dab_tuned_index < 0) {
+		err = si468x_core_cmd_dab_rsq_status(core, &rsq_args,
+						     &rsq_report);
+		if (err < 0)
+			return err;
+		core->dab_tuned_index = rsq_report.tune_index;
+	}
+	if (channel->frequency_index != core->dab_tuned_index) {
 		tune_args.dab_freq_list = core->loaded_dab_freq_list;
 		tune_args.freq = channel->frequency;
 		err = si468x_core_cmd_dab_tune_freq(core, &tune_args);
@@ -1301,8 +2256,6 @@ int si468x_core_cmd_dab_get_digital_service_data(struct si468x_core *core,
 		struct si468x_digital_service_data_status_report *report)
 {
 	int err;
-	u8 *payload;
-	char cmd_rd_reply = CMD_RD_REPLY;
 	u8 resp[CMD_GET_DIGITAL_SERVICE_DATA_NRESP];
 	u8 args[CMD_GET_DIGITAL_SERVICE_DATA_NARGS] = {
 		status_only << 4 | intack,
@@ -1330,33 +2283,15 @@ int si468x_core_cmd_dab_get_digital_service_data(struct si468x_core *core,
 	if (status_only)
 		return err;
 
+	/* the payload follows the header in the same reply */
+	err = si468x_core_read_offset(core, ARRAY_SIZE(resp),
+				      report->payload, report->byte_count);
+	if (err < 0)
+		dev_err(core->dev, "Failed to get payload %x\n", err);
 
-	payload = kmalloc(report->byte_count + ARRAY_SIZE(resp),
-			  GFP_KERNEL);
-	if (!payload)
-		return -ENOMEM;
-
-	/* not beautiful, but issue RD_REPLY again to get payload */
-	err = core->bus_ops->write(core, &cmd_rd_reply, sizeof(cmd_rd_reply));
-	if (err < 0) {
-		dev_err(core->dev, "Failed to send CMD_RD_REPLY %x\n", err);
-		goto free_kmem;
-	}
-
-	err = core->bus_ops->read(core, payload,
-				  report->byte_count + ARRAY_SIZE(resp));
-	if (err < 0) {
-		dev_err(core->dev, "Failed to get reply %x\n", err);
-		goto free_kmem;
-	}
-	memcpy(report->payload, payload + ARRAY_SIZE(resp),
-	       report->byte_count);
-free_kmem:
-	kfree(payload);
-
-	return err;
-}
-EXPORT_SYMBOL_GPL(si468x_core_cmd_dab_get_digital_service_data);
+	return err;
+}
+EXPORT_SYMBOL_GPL(si468x_core_cmd_dab_get_digital_service_data);
 
 /**
  * si468x_core_get_digital_service_list() - get new list worker if
@@ -1366,22 +2301,124 @@ EXPORT_SYMBOL_GPL(si468x_core_cmd_dab_get_digital_service_data);
  */
 static inline void si468x_core_get_digital_service_list(struct si468x_core *core)
 {
-	schedule_work(&core->update_service_list);
+	si468x_core_submit(core, &core->service_list_req);
+}
+
+static bool si468x_core_dab_channel_changed(const struct si468x_dab_channel *a,
+					    const struct si468x_dab_channel *b)
+{
+	return a->country_id != b->country_id ||
+	       a->extended_country_code != b->extended_country_code ||
+	       a->is_data_service != b->is_data_service ||
+	       a->is_audio_service != b->is_audio_service ||
+	       memcmp(&a->component_info, &b->component_info,
+		      sizeof(a->component_info)) ||
+	       strcmp(a->service_label, b->service_label);
 }
 
 /**
- * si468x_core_new_digital_service_list() - updates service list.
- * @work: struct work_struct being passed to the function by the
- * kernel.
+ * si468x_core_merge_dab_channels() - merge a service list into the
+ * channel database
+ * @core: Core device structure
+ * @list: service list of the tuned ensemble
+ * @rsq_report: signal quality of the tuned ensemble
+ *
+ * Unchanged services are updated in place. Changed services replace
+ * their old entry, so readers never miss them, and keep the started
+ * flag. Entries of this ensemble left with the old generation are gone
+ * from the list and removed afterwards.
+ *
+ * Function returns 0 on succsess and negative error code on
+ * failure
  */
-void si468x_core_new_digital_service_list(struct work_struct *work)
+static int si468x_core_merge_dab_channels(struct si468x_core *core,
+					  struct si468x_dab_service_list *list,
+					  struct si468x_rsq_status_report *rsq_report)
 {
-	int err;
+	struct si468x_chdb *db = &core->dab_channels;
+	struct si468x_dab_service_info *info;
+	struct si468x_dab_channel *channel, *old;
+	struct si468x_dab_channel *ptr, *next;
+	struct si468x_dab_channel tmp;
 	int srvnr, compnr;
-	u8  max_signal_strength;
+	int err = 0;
 
-	struct si468x_core *core = container_of(work, struct si468x_core,
-						update_service_list);
+	db->generation++;
+	for (srvnr = 0; srvnr < list->number_of_services; srvnr++) {
+		info = &list->si468x_dab_service_info[srvnr];
+		if (info->is_data_service)
+			continue;
+		for (compnr = 0; compnr < info->number_of_components; compnr++) {
+			memset(&tmp, 0, sizeof(tmp));
+			tmp.version = list->version;
+			tmp.frequency_index = rsq_report->tune_index;
+			tmp.frequency = rsq_report->readfreq;
+			tmp.fic_quality = rsq_report->fic_quality;
+			tmp.signal_strength = rsq_report->rssi;
+			tmp.service_id = info->service_id;
+			tmp.country_id = info->country_id;
+			tmp.is_data_service = info->is_data_service;
+			tmp.is_audio_service = info->is_audio_service;
+			tmp.component_info =
+				info->si468x_dab_component_info[compnr];
+			strscpy(tmp.service_label, info->service_label,
+				sizeof(tmp.service_label));
+
+			old = si468x_chdb_find(db, tmp.frequency,
+					       tmp.service_id,
+					       tmp.component_info.sub_ch_id);
+			if (old && old->generation != db->generation &&
+			    !si468x_core_dab_channel_changed(old, &tmp)) {
+				WRITE_ONCE(old->version, tmp.version);
+				WRITE_ONCE(old->frequency_index,
+					   tmp.frequency_index);
+				WRITE_ONCE(old->fic_quality, tmp.fic_quality);
+				WRITE_ONCE(old->signal_strength,
+					   tmp.signal_strength);
+				old->generation = db->generation;
+				continue;
+			}
+
+			channel = si468x_chdb_alloc();
+			if (!channel) {
+				err = -ENOMEM;
+				goto drop_stale;
+			}
+			*channel = tmp;
+			if (old) {
+				channel->is_started = old->is_started;
+				si468x_chdb_replace(db, old, channel);
+			} else {
+				si468x_chdb_add(db, channel);
+			}
+		}
+	}
+
+drop_stale:
+	list_for_each_entry_safe(ptr, next, &db->list, list) {
+		if (ptr->frequency_index == rsq_report->tune_index &&
+		    ptr->generation != db->generation)
+			si468x_chdb_del(db, ptr);
+	}
+
+	return err;
+}
+
+/**
+ * si468x_core_new_digital_service_list() - updates service list.
+ * @core: Core device structure
+ * @req: the service list request
+ *
+ * The list is only fetched if the chip reports a version other than
+ * the one already merged for the tuned ensemble.
+ */
+static int si468x_core_new_digital_service_list(struct si468x_core *core,
+						struct si468x_cmd_request *req)
+{
+	int err;
+	u8  max_signal_strength = 0;
+	struct si468x_chdb *db = &core->dab_channels;
+	int *version;
 
 	struct si468x_event_status_args eventargs;
 	struct si468x_event_status_report report;
@@ -1394,9 +2431,8 @@ void si468x_core_new_digital_service_list(struct work_struct *work)
 		.stcack		= false,
 	};
 	struct si468x_rsq_status_report rsq_report;
-	struct si468x_dab_service_list *list;
-	struct si468x_dab_channel *channel;
-	struct si468x_dab_channel *ptr, *next;
+	struct si468x_dab_service_list *list = NULL;
+	struct si468x_dab_channel *ptr;
 	struct si468x_tune_freq_args args = {
 		.injside	= SI468X_INJSIDE_AUTO,
 		.antcap		= 0,
@@ -1405,64 +2441,40 @@ void si468x_core_new_digital_service_list(struct work_struct *work)
 	};
 
 	eventargs.eventack = true;
-	si468x_core_lock(core);
 	err = si468x_core_cmd_dab_event_status(core, &eventargs, &report);
 	if (err < 0)
-		goto unlock;
+		return err;
 	err = si468x_core_cmd_dab_rsq_status(core, &rsq_args, &rsq_report);
 	if (err < 0)
-		goto unlock;
+		return err;
+	if (rsq_report.tune_index >= SI468X_DAB_MAX_FREQUENCIES)
+		return -EINVAL;
+
+	if (!atomic_read(&core->dab_full_scan))
+		si468x_follow_update(core, &report, &rsq_report);
+
+	version = &core->dab_svrlist_version[rsq_report.tune_index];
+	if (!report.svrlist || *version == report.svrlistver) {
+		core->dab_svrlist_skips++;
+		goto scan;
+	}
 
 	list = kzalloc(sizeof(struct si468x_dab_service_list),
 		       GFP_KERNEL);
 	if (!list)
-		goto unlock;
+		return -ENOMEM;
 	err = si468x_core_cmd_dab_get_service_list(core, list);
 	if (err < 0) {
 		goto free_kmem;
 	}
+	core->dab_svrlist_fetches++;
 
-	list_for_each_entry_safe(ptr, next, &si468x_dab_channel_list, list) {
-		if (ptr->frequency_index == rsq_report.tune_index) {
-			list_del(&ptr->list);
-			kfree(ptr);
-		}
-	}
-
-	for (srvnr = 0; /* save list */
-	     srvnr < list->number_of_services;
-	     srvnr++) {
-		for (compnr = 0;
-		     compnr < list->si468x_dab_service_info[srvnr].number_of_components;
-		     compnr++) {
-			if (list->si468x_dab_service_info[srvnr].is_data_service)
-				continue;
-			channel = kzalloc(sizeof(struct si468x_dab_channel), GFP_KERNEL);
-			if (!channel)
-				goto free_kmem;
-			INIT_LIST_HEAD(&channel->list);
-			list_add_tail(&channel->list, &si468x_dab_channel_list);
-			channel->version = list->version;
-			channel->frequency_index = rsq_report.tune_index;
-			channel->frequency = rsq_report.readfreq;
-			channel->fic_quality = rsq_report.fic_quality;
-			channel->signal_strength = rsq_report.rssi;
-			channel->service_id =
-			list->si468x_dab_service_info[srvnr].service_id;
-			channel->country_id =
-			list->si468x_dab_service_info[srvnr].country_id;
-			channel->is_data_service =
-			list->si468x_dab_service_info[srvnr].is_data_service;
-			channel->is_audio_service =
-			list->si468x_dab_service_info[srvnr].is_audio_service;
-			channel->component_info =
-			list->si468x_dab_service_info[srvnr].si468x_dab_component_info[compnr];
-			strscpy(channel->service_label,
-				list->si468x_dab_service_info[srvnr].service_label,
-				sizeof(list->si468x_dab_service_info[srvnr].service_label));
-		}
-	}
+	err = si468x_core_merge_dab_channels(core, list, &rsq_report);
+	if (err < 0)
+		goto free_kmem;
+	*version = list->version;
 
+scan:
 	if (atomic_read(&core->dab_full_scan)) {
 		if (core->loaded_dab_freq_list[rsq_report.tune_index + 1].frequency) {
 			args.dab_freq_list = core->loaded_dab_freq_list;
@@ -1473,11 +2485,11 @@ void si468x_core_new_digital_service_list(struct work_struct *work)
 		} else {
 			atomic_set(&core->dab_full_scan, 0);
 			/* tune to max rssi, first audio service */
-			list_for_each_entry(ptr, &si468x_dab_channel_list, list) {
+			list_for_each_entry(ptr, &db->list, list) {
 				max_signal_strength = max(ptr->signal_strength,
 							  max_signal_strength);
 			}
-			list_for_each_entry(ptr, &si468x_dab_channel_list, list) {
+			list_for_each_entry(ptr, &db->list, list) {
 				if(ptr->signal_strength == max_signal_strength &&
 				   ptr->is_audio_service)
 					break;
@@ -1504,8 +2516,8 @@ void si468x_core_new_digital_service_list(struct work_struct *work)
 	}
 free_kmem:
 	kfree(list);
-unlock:
-	si468x_core_unlock(core);
+
+	return err;
 }
 /**
  * si468x_core_get_digital_service_data() - get new data worker if
@@ -1515,56 +2527,145 @@ unlock:
  */
 static inline void si468x_core_get_digital_service_data(struct si468x_core *core)
 {
-	mutex_lock(&core->digital_service_drainer_status_lock);
-	if (!core->digital_service_drainer_is_working) {
-		core->digital_service_drainer_is_working = true;
-		schedule_work(&core->update_service_data);
+	si468x_core_submit(core, &core->service_data_req);
+}
+
+static bool si468x_core_dls_same_tags(const struct si468x_dls *dls,
+				      const u8 *cmd, int n)
+{
+	int i;
+
+	if (dls->nr_tags != n ||
+	    dls->item_toggle != !!(cmd[0] & SI468X_DL_PLUS_IT) ||
+	    dls->item_running != !!(cmd[0] & SI468X_DL_PLUS_IR))
+		return false;
+
+	for (i = 0; i < n; i++) {
+		if (dls->tags[i].content_type != (cmd[1 + 3 * i] & 0x7f) ||
+		    dls->tags[i].start != (cmd[2 + 3 * i] & 0x7f) ||
+		    dls->tags[i].length != (cmd[3 + 3 * i] & 0x7f) + 1)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * si468x_core_new_dls() - store a DLS message
+ * @core: Core device structure, locked
+ * @buf:  payload of the packet, prefix followed by the label or command
+ * @len:  bytes in @buf
+ *
+ * Labels and DL Plus commands (ETSI TS 102 980) are stored in
+ * core->dls under its seqlock, so readers never wait for the core
+ * lock. Repetitions of the current label or tags are ignored.
+ */
+static void si468x_core_new_dls(struct si468x_core *core,
+				const u8 *buf, int len)
+{
+	struct si468x_dls *dls = &core->dls;
+	bool toggle;
+	int i, n;
+
+	if (len < 2)
+		return;
+	toggle = buf[0] & SI468X_DLS_TOGGLE;
+
+	if (!(buf[0] & SI468X_DLS_C_FLAG)) {
+		/* the payload is not zero terminated */
+		n = min(len - 2, SI468X_DAB_DL_PLUS_MAX_TEXT_LENGTH - 1);
+		if (dls->toggle == toggle && !dls->text[n] &&
+		    !memcmp(dls->text, buf + 2, n))
+			return;
+
+		write_seqlock(&core->dls_lock);
+		memcpy(dls->text, buf + 2, n);
+		dls->text[n] = '\0';
+		dls->toggle = toggle;
+		/* the tags of the old label do not apply */
+		dls->nr_tags = 0;
+		dls->change++;
+		write_sequnlock(&core->dls_lock);
+	} else if ((buf[0] & SI468X_DLS_COMMAND) == SI468X_DLS_CMD_CLEAR) {
+		/* remove the label from the display */
+		if (!dls->text[0] && !dls->nr_tags)
+			return;
+
+		write_seqlock(&core->dls_lock);
+		dls->text[0] = '\0';
+		dls->nr_tags = 0;
+		dls->change++;
+		write_sequnlock(&core->dls_lock);
+	} else if ((buf[0] & SI468X_DLS_COMMAND) == SI468X_DLS_CMD_DL_PLUS) {
+		buf += 2;
+		len -= 2;
+		/* only the DL Plus tags command (CId 0) */
+		if (len < 1 || buf[0] >> 4)
+			return;
+		n = (buf[0] & SI468X_DL_PLUS_NT) + 1;
+		if (len < 1 + 3 * n || si468x_core_dls_same_tags(dls, buf, n))
+			return;
+
+		write_seqlock(&core->dls_lock);
+		dls->item_toggle = buf[0] & SI468X_DL_PLUS_IT;
+		dls->item_running = buf[0] & SI468X_DL_PLUS_IR;
+		dls->nr_tags = n;
+		for (i = 0; i < n; i++) {
+			dls->tags[i].content_type = buf[1 + 3 * i] & 0x7f;
+			dls->tags[i].start = buf[2 + 3 * i] & 0x7f;
+			dls->tags[i].length = (buf[3 + 3 * i] & 0x7f) + 1;
+		}
+		dls->change++;
+		write_sequnlock(&core->dls_lock);
+	} else {
+		return;
 	}
-	mutex_unlock(&core->digital_service_drainer_status_lock);
+
+	/* a new label drops the tags as well */
+	sysfs_notify(&core->dev->kobj, NULL, "si468x_dynamic_label");
+	sysfs_notify(&core->dev->kobj, NULL, "si468x_dl_plus");
+	blocking_notifier_call_chain(&core->notifier, SI468X_EVENT_DLS, dls);
 }
 
 /**
  * si468x_core_new_digital_service_data() - updates service data.
- * @work: struct work_struct being passed to the function by the
- * kernel.
+ * @core: Core device structure
+ * @req: the service data request
  */
-void si468x_core_new_digital_service_data(struct work_struct *work)
+static int si468x_core_new_digital_service_data(struct si468x_core *core,
+						struct si468x_cmd_request *req)
 {
 	int err;
-	struct si468x_core *core = container_of(work, struct si468x_core,
-						update_service_data);
 	struct si468x_digital_service_data_status_report report;
 
-	si468x_core_lock(core);
-
 	err = si468x_core_cmd_dab_get_digital_service_data(core, true, true, &report);
 	if (err < 0)
-		goto unlock;
+		return err;
 
 	if (report.dsrvovflint)
 		dev_err(core->dev, "data services system overflow\n");
 	if (report.buff_count == 0) /* no buffer available */
-		goto unlock;
+		return 0;
 
-	report.payload = kzalloc(SI468X_SERVICE_DATA_MAX_LENGTH, GFP_KERNEL);
+	/* read straight into the data ring if it is read and has room */
+	report.payload = si468x_dsrv_reserve(core, &report);
 	if (!report.payload)
-		goto unlock;
+		report.payload = core->dsrv_scratch;
 
 	err = si468x_core_cmd_dab_get_digital_service_data(core, false, true, &report);
 	if (err < 0)
-		goto free_kmem;
+		return err;
 
-	if ((report.data_src == 2) && ((report.payload[0] & 0x7f) == 0))
-		strscpy(core->si468x_dls_message,
-			report.payload + 2,
-			SI468X_DAB_DL_PLUS_MAX_TEXT_LENGTH);
-free_kmem:
-	kfree(report.payload);
-unlock:
-	si468x_core_unlock(core);
-	mutex_lock(&core->digital_service_drainer_status_lock);
-	core->digital_service_drainer_is_working = false;
-	mutex_unlock(&core->digital_service_drainer_status_lock);
+	if (report.data_src == SI468X_DATA_SRC_DLS)
+		si468x_core_new_dls(core, report.payload, report.byte_count);
+
+	if (report.uatype == SI468X_UATYPE_MOT_SLIDESHOW)
+		si468x_mot_receive(core, &report);
+
+	if (report.payload != core->dsrv_scratch)
+		si468x_dsrv_commit(core);
+
+	return err;
 }
 
 static int si468x_cmd_clear_stc(struct si468x_core *core)
@@ -1596,13 +2697,29 @@ static int si468x_cmd_clear_stc(struct si468x_core *core)
 	return err;
 }
 
+/**
+ * si468x_cmd_tune_seek_freq() - send a tune or seek command and wait
+ * for STC
+ * @core: Core device structure, locked
+ * @cmd: command to send
+ * @args: arguments of @cmd
+ * @argn: number of @args
+ * @resp: response buffer
+ * @respn: size of @resp
+ *
+ * The core lock is held until STC, callers may keep pointers into the
+ * channel database across the tune.
+ */
 static int si468x_cmd_tune_seek_freq(struct si468x_core *core,
 				     uint8_t cmd,
 				     const uint8_t args[], size_t argn,
 				     uint8_t *resp, size_t respn)
 {
 	int err;
+	ktime_t start = 0;
 
+	if (trace_si468x_tune_enabled())
+		start = ktime_get();
 	atomic_set(&core->stc, 0);
 	err = si468x_core_send_command(core, cmd, args, argn, resp, respn,
 				       SI468X_TIMEOUT_TUNE);
@@ -1611,10 +2728,133 @@ static int si468x_cmd_tune_seek_freq(struct si468x_core *core,
 				    atomic_read(&core->stc));
 		si468x_cmd_clear_stc(core);
 	}
+	trace_si468x_tune(core->dev, cmd,
+			  start ? ktime_us_delta(ktime_get(), start) : 0,
+			  (err < 0) ? 0 : resp[0], core->chip_state, err);
+
+	return err;
+}
+
+/**
+ * si468x_core_stream_property() - send 'SET_PROPERTY' during a bulk sync
+ * @core: Core device structure
+ * @args: SET_PROPERTY arguments
+ *
+ * The chip answers SET_PROPERTY within a few tens of microseconds, so
+ * the bus is kept and CTS is polled at a short interval instead of
+ * going through the interrupt handshake of si468x_core_send_command().
+ * Back to back writes then only cost the bus transfers.
+ *
+ * Function returns 0 on succsess and negative error code on
+ * failure
+ */
+static int si468x_core_stream_property(struct si468x_core *core,
+				       const u8 args[CMD_SET_PROPERTY_NARGS])
+{
+	u8 data[CMD_SET_PROPERTY_NARGS + 1];
+	u8 resp[CMD_SET_PROPERTY_NRESP];
+	u8 status = 0;
+	ktime_t start, timeout;
+	s64 cts_us = 0;
+	int err;
+
+	if (core->power_state == SI468X_STATE_POWER_DOWN)
+		return -EIO;
+
+	data[0] = CMD_SET_PROPERTY;
+	memcpy(&data[1], args, CMD_SET_PROPERTY_NARGS);
+
+	mutex_lock(&core->bus_lock);
+	err = core->bus_ops->write(core, (char *) data, sizeof(data));
+	if (err != sizeof(data)) {
+		mutex_unlock(&core->bus_lock);
+		dev_err(core->dev,
+			"Error while sending command 0x%02x\n",
+			CMD_SET_PROPERTY);
+		err = (err >= 0) ? -EIO : err;
+		goto exit;
+	}
+	atomic_set(&core->cts, 0);
+
+	start = ktime_get();
+	timeout = ktime_add_us(start, SI468X_DEFAULT_TIMEOUT);
+	for (;;) {
+		err = __si468x_core_read_reply(core, resp, sizeof(resp));
+		if (err < 0 || (resp[0] & SI468X_CTS))
+			break;
+		if (!ktime_before(ktime_get(), timeout)) {
+			err = -ETIMEDOUT;
+			break;
+		}
+		usleep_range(SI468X_PROP_SYNC_POLL_INTERVAL,
+			     2 * SI468X_PROP_SYNC_POLL_INTERVAL);
+	}
+	mutex_unlock(&core->bus_lock);
+	if (trace_si468x_cmd_enabled())
+		cts_us = ktime_us_delta(ktime_get(), start);
 
+	if (err < 0) {
+		dev_err(core->dev, "Failed to poll reply %x\n", err);
+		goto exit;
+	}
+	core->cmd_stats[CMD_SET_PROPERTY].polled++;
+
+	status = resp[0];
+	err = si468x_core_check_reply(core, CMD_SET_PROPERTY, resp, err);
+exit:
+	trace_si468x_cmd(core->dev, CMD_SET_PROPERTY, CMD_SET_PROPERTY_NARGS,
+			 CMD_SET_PROPERTY_NRESP, cts_us, status, 0,
+			 core->chip_state, err);
 	return err;
 }
 
+/**
+ * si468x_core_read_offset() - read a part of the last reply
+ * @core:   Core device structure
+ * @offset: offset into the reply, counted from the first status byte
+ * @buf:    buffer for the data
+ * @len:    number of bytes to read
+ *
+ * Large replies are fetched in chunks of SI468X_READ_OFFSET_CHUNK bytes
+ * with READ_OFFSET, after the command itself was sent once with a
+ * reply buffer just long enough for its header. READ_OFFSET does not
+ * replace the reply of that command, so the chunks can be read in any
+ * order. The caller holds the core lock for the whole sequence.
+ *
+ * Function returns 0 on succsess and negative error code on
+ * failure
+ */
+int si468x_core_read_offset(struct si468x_core *core, u16 offset,
+			    u8 *buf, int len)
+{
+	/* the data follows the status bytes of READ_OFFSET */
+	const int status = CMD_READ_OFFSET_NRESP - 1;
+	u8 *resp = core->read_offset_buf;
+	u8 args[CMD_READ_OFFSET_NARGS];
+	int chunk;
+	int err;
+
+	while (len > 0) {
+		chunk = min(len, SI468X_READ_OFFSET_CHUNK);
+		args[0] = 0;
+		args[1] = lsb(offset);
+		args[2] = msb(offset);
+		err = si468x_core_send_command(core, CMD_READ_OFFSET,
+					       args, ARRAY_SIZE(args),
+					       resp, status + chunk,
+					       SI468X_DEFAULT_TIMEOUT);
+		if (err < 0)
+			return err;
+		memcpy(buf, resp + status, chunk);
+		buf += chunk;
+		offset += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(si468x_core_read_offset);
+
 /**
  * si468x_cmd_set_property() - send 'SET_PROPERTY' command to the device
  * @core:    device to send the command to
@@ -1641,6 +2881,9 @@ int si468x_core_cmd_set_property(struct si468x_core *core,
 		return -EIO;
 	}
 
+	if (core->prop_sync_active)
+		return si468x_core_stream_property(core, args);
+
 	return si468x_core_send_command(core, CMD_SET_PROPERTY,
 					args, ARRAY_SIZE(args),
 					resp, ARRAY_SIZE(resp),
@@ -1684,7 +2927,7 @@ EXPORT_SYMBOL_GPL(si468x_core_cmd_get_property);
 
 
 int si468x_core_flash_nvm(struct si468x_core *core,
-			  const char *name)
+			  enum si468x_func func)
 {
 	int err;
 
@@ -1693,12 +2936,12 @@ int si468x_core_flash_nvm(struct si468x_core *core,
 		return -EIO;
 	}
 	err = si468x_cmd_load_firmware(core,
-				       name,
+				       func,
 				       SI468X_LOAD_TO_FLASH);
 	if (err < 0)
 		dev_err(core->dev,
 			"Failed to flash %s (err = %d)\n",
-			name, err);
+			si468x_func_string_table[func], err);
 	return err;
 }
 
@@ -1712,7 +2955,7 @@ static ssize_t si468x_nvram_store(struct device *dev,
 		0xde,
 		0xc0,
 	};
-	int err;
+	int err, i;
 	struct si468x_core *core = dev_get_drvdata(dev);
 
 	si468x_core_lock(core);
@@ -1733,16 +2976,20 @@ static ssize_t si468x_nvram_store(struct device *dev,
 		if (err < 0)
 			dev_err(core->dev,
 				"Failed to erase nvram (err = %d)\n", err);
+		for (i = 0; i < SI468X_FW_IMAGES; i++) {
+			core->fw_cache[i].in_nvm = false;
+			core->fw_cache[i].nvm_checked = false;
+		}
 	} else if (sysfs_streq(buf, si468x_func_string_table[SI468X_FUNC_MINI_BOOT])) {
-		err = si468x_core_flash_nvm(core, si468x_func_string_table[SI468X_FUNC_MINI_BOOT]);
+		err = si468x_core_flash_nvm(core, SI468X_FUNC_MINI_BOOT);
 	} else if (sysfs_streq(buf, si468x_func_string_table[SI468X_FUNC_BOOTLOADER])) {
-		err = si468x_core_flash_nvm(core, si468x_func_string_table[SI468X_FUNC_BOOTLOADER]);
+		err = si468x_core_flash_nvm(core, SI468X_FUNC_BOOTLOADER);
 	} else if (sysfs_streq(buf, si468x_func_string_table[SI468X_FUNC_AM_RECEIVER])) {
-		err = si468x_core_flash_nvm(core, si468x_func_string_table[SI468X_FUNC_AM_RECEIVER]);
+		err = si468x_core_flash_nvm(core, SI468X_FUNC_AM_RECEIVER);
 	} else if (sysfs_streq(buf, si468x_func_string_table[SI468X_FUNC_FM_RECEIVER])) {
-		err = si468x_core_flash_nvm(core, si468x_func_string_table[SI468X_FUNC_FM_RECEIVER]);
+		err = si468x_core_flash_nvm(core, SI468X_FUNC_FM_RECEIVER);
 	} else if (sysfs_streq(buf, si468x_func_string_table[SI468X_FUNC_DAB_RECEIVER])) {
-		err = si468x_core_flash_nvm(core, si468x_func_string_table[SI468X_FUNC_DAB_RECEIVER]);
+		err = si468x_core_flash_nvm(core, SI468X_FUNC_DAB_RECEIVER);
 	} else {
 		dev_err(core->dev, "si468x_nvram invalid\n");
 		err = -EINVAL;
@@ -1778,68 +3025,657 @@ static ssize_t si468x_property_store(struct device *dev,
 	}
 }
 
+/**
+ * si468x_core_dab_forget() - drop the cached DAB frequencies and services
+ * @core: Core device structure, locked by the caller
+ *
+ * Called before a full band scan builds them again.
+ */
+void si468x_core_dab_forget(struct si468x_core *core)
+{
+	si468x_chdb_clear(&core->dab_channels);
+	memset(core->loaded_dab_freq_list, 0,
+	       sizeof(core->loaded_dab_freq_list));
+	memset(core->dab_svrlist_version, 0xff,
+	       sizeof(core->dab_svrlist_version));
+}
+EXPORT_SYMBOL_GPL(si468x_core_dab_forget);
+
+static int si468x_core_dab_nr_freqs(struct si468x_core *core)
+{
+	int n = 0;
+
+	while (n < SI468X_DAB_MAX_FREQUENCIES &&
+	       core->loaded_dab_freq_list[n].frequency)
+		n++;
+
+	return n;
+}
+
+/**
+ * si468x_core_dab_start_cached() - start the last service of the cache
+ * @core: Core device structure, locked by the caller
+ *
+ * Loads the cached frequencies into the chip and starts the service
+ * that ran last, or the first audio service, without a band scan. The
+ * service list interrupt is enabled, so
+ * si468x_core_new_digital_service_list() revalidates the services of
+ * the tuned ensemble in the background.
+ *
+ * Returns -ENOENT if nothing usable is cached or the cached ensemble
+ * is gone, another negative error code on failure and 0 on success.
+ */
+int si468x_core_dab_start_cached(struct si468x_core *core)
+{
+	struct si468x_tune_freq_args args = {
+		.injside	= SI468X_INJSIDE_AUTO,
+		.antcap		= 0,
+		.direct_tune	= SI468X_SELECT_MAIN_PROGRAM_SERVICE,
+		.program_id	= 0,
+	};
+	struct si468x_rsq_status_args rsq_args = {
+		.rsqack		= false,
+		.digradack	= false,
+		.attune		= false,
+		.cancel		= false,
+		.fiberrack	= false,
+		.stcack		= false,
+	};
+	struct si468x_rsq_status_report rsq_report;
+	struct si468x_dab_channel *ptr, *last = NULL;
+	int nr_freqs = si468x_core_dab_nr_freqs(core);
+	int err;
+
+	if (!nr_freqs)
+		return -ENOENT;
+
+	list_for_each_entry(ptr, &core->dab_channels.list, list) {
+		if (ptr->is_started && !last)
+			last = ptr;
+		ptr->is_started = false;
+	}
+	if (!last) {
+		list_for_each_entry(ptr, &core->dab_channels.list, list) {
+			if (ptr->is_audio_service) {
+				last = ptr;
+				break;
+			}
+		}
+	}
+	if (!last)
+		return -ENOENT;
+
+	err = si468x_core_cmd_dab_set_freq_list(core,
+						core->loaded_dab_freq_list,
+						nr_freqs,
+						SI468X_DAB_MAX_FREQUENCIES);
+	if (err < 0)
+		return err;
+
+	err = regmap_update_bits(core->regmap_dab,
+				 SI468X_PROP_DAB_EVENT_INTERRUPT_SOURCE,
+				 SI468X_PROP_SRVLIST_INTEN_MASK,
+				 SI468X_PROP_SRVLIST_INTEN);
+	if (err < 0)
+		return err;
+
+	args.dab_freq_list = core->loaded_dab_freq_list;
+	args.freq = last->frequency;
+	err = si468x_core_cmd_dab_tune_freq(core, &args);
+	if (err < 0)
+		return err;
+
+	err = si468x_core_cmd_dab_rsq_status(core, &rsq_args, &rsq_report);
+	if (err < 0)
+		return err;
+	if (!rsq_report.valid)
+		return -ENOENT;
+
+	err = regmap_update_bits(core->regmap_common,
+				 SI468X_PROP_DIGITAL_SERVICE_INT_SOURCE,
+				 SI468X_PROP_DSRV_INTEN_MASK,
+				 SI468X_PROP_DSRVPCKTINT_INTEN |
+				 SI468X_PROP_DSRVOVFLINT_INTEN);
+	if (err < 0)
+		return err;
+
+	return si468x_core_cmd_dab_start_service(core, last);
+}
+EXPORT_SYMBOL_GPL(si468x_core_dab_start_cached);
+
+static size_t si468x_core_dab_cache_size(int nr_freqs, int nr_channels)
+{
+	return sizeof(struct si468x_dab_cache_header) +
+	       nr_freqs * sizeof(__le32) +
+	       nr_channels * sizeof(struct si468x_dab_cache_channel);
+}
+
+/**
+ * si468x_core_dab_cache_export() - write the DAB cache blob
+ * @core: Core device structure, locked by the caller
+ * @buf:  buffer of SI468X_DAB_CACHE_MAX_BYTES
+ *
+ * Returns the size of the blob.
+ */
+static size_t si468x_core_dab_cache_export(struct si468x_core *core, u8 *buf)
+{
+	struct si468x_dab_cache_header *hdr = (void *)buf;
+	struct si468x_dab_cache_channel *c;
+	struct si468x_dab_component_info *comp;
+	struct si468x_dab_channel *ptr;
+	int nr_freqs = si468x_core_dab_nr_freqs(core);
+	int nr_channels = 0;
+	__le32 *freq;
+	int i;
+
+	freq = (__le32 *)(hdr + 1);
+	for (i = 0; i < nr_freqs; i++)
+		freq[i] = cpu_to_le32(core->loaded_dab_freq_list[i].frequency);
+
+	c = (struct si468x_dab_cache_channel *)(freq + nr_freqs);
+	list_for_each_entry(ptr, &core->dab_channels.list, list) {
+		if (nr_channels == SI468X_DAB_CACHE_MAX_CHANNELS)
+			break;
+		comp = &ptr->component_info;
+		c->frequency		= cpu_to_le32(ptr->frequency);
+		c->service_id		= cpu_to_le32(ptr->service_id);
+		c->version		= cpu_to_le16(ptr->version);
+		c->frequency_index	= ptr->frequency_index;
+		c->fic_quality		= ptr->fic_quality;
+		c->signal_strength	= ptr->signal_strength;
+		c->country_id		= ptr->country_id;
+		c->extended_country_code = ptr->extended_country_code;
+		c->flags =
+			(ptr->is_data_service ? SI468X_DAB_CACHE_DATA : 0) |
+			(ptr->is_audio_service ? SI468X_DAB_CACHE_AUDIO : 0) |
+			(ptr->is_started ? SI468X_DAB_CACHE_STARTED : 0) |
+			(comp->dg_flag ? SI468X_DAB_CACHE_DG : 0) |
+			(comp->is_primary ? SI468X_DAB_CACHE_PRIMARY : 0) |
+			(comp->is_secondary ? SI468X_DAB_CACHE_SECONDARY : 0) |
+			(comp->access_control_flag ? SI468X_DAB_CACHE_CA : 0) |
+			(comp->mua_info_valid ? SI468X_DAB_CACHE_MUA : 0);
+		c->tm_id		= comp->tm_id;
+		c->sub_ch_id		= comp->sub_ch_id;
+		c->fidc_id		= comp->fidc_id;
+		c->sc_id		= comp->sc_id;
+		c->audio_service_type	= comp->audio_service_type;
+		c->data_service_type	= comp->data_service_type;
+		memcpy(c->service_label, ptr->service_label,
+		       sizeof(c->service_label));
+		c++;
+		nr_channels++;
+	}
+
+	hdr->magic	 = cpu_to_le32(SI468X_DAB_CACHE_MAGIC);
+	hdr->version	 = cpu_to_le16(SI468X_DAB_CACHE_VERSION);
+	hdr->nr_freqs	 = cpu_to_le16(nr_freqs);
+	hdr->nr_channels = cpu_to_le16(nr_channels);
+	hdr->reserved	 = 0;
+	hdr->crc	 = cpu_to_le32(crc32_le(~0, (u8 *)(hdr + 1),
+					(u8 *)c - (u8 *)(hdr + 1)));
+
+	return (u8 *)c - buf;
+}
+
+/**
+ * si468x_core_dab_cache_import() - replace the DAB cache by a blob
+ * @core: Core device structure, locked by the caller
+ * @buf:  blob written by si468x_core_dab_cache_export()
+ * @len:  size of @buf
+ *
+ * The cache is only replaced if the whole blob is valid. A blob
+ * without frequencies drops the cache.
+ *
+ * Function returns 0 on succsess and negative error code on
+ * failure
+ */
+static int si468x_core_dab_cache_import(struct si468x_core *core,
+					const u8 *buf, size_t len)
+{
+	const struct si468x_dab_cache_header *hdr = (const void *)buf;
+	const struct si468x_dab_cache_channel *c;
+	struct si468x_dab_component_info *comp;
+	struct si468x_dab_channel *ptr, *next;
+	const __le32 *freq;
+	int nr_freqs, nr_channels;
+	LIST_HEAD(channels);
+	size_t size;
+	int err = -EINVAL;
+	int i;
+
+	if (len < sizeof(*hdr) ||
+	    le32_to_cpu(hdr->magic) != SI468X_DAB_CACHE_MAGIC)
+		return -EINVAL;
+	if (le16_to_cpu(hdr->version) != SI468X_DAB_CACHE_VERSION) {
+		dev_err(core->dev, "DAB cache version %u not supported\n",
+			le16_to_cpu(hdr->version));
+		return -EINVAL;
+	}
+
+	nr_freqs = le16_to_cpu(hdr->nr_freqs);
+	nr_channels = le16_to_cpu(hdr->nr_channels);
+	if (nr_freqs > SI468X_DAB_MAX_FREQUENCIES ||
+	    nr_channels > SI468X_DAB_CACHE_MAX_CHANNELS)
+		return -EINVAL;
+	size = si468x_core_dab_cache_size(nr_freqs, nr_channels);
+	if (len < size ||
+	    le32_to_cpu(hdr->crc) != crc32_le(~0, (const u8 *)(hdr + 1),
+					      size - sizeof(*hdr)))
+		return -EINVAL;
+
+	freq = (const __le32 *)(hdr + 1);
+	c = (const struct si468x_dab_cache_channel *)(freq + nr_freqs);
+	for (i = 0; i < nr_channels; i++, c++) {
+		if (c->frequency_index >= nr_freqs ||
+		    le32_to_cpu(freq[c->frequency_index]) !=
+		    le32_to_cpu(c->frequency))
+			goto free_channels;
+
+		ptr = si468x_chdb_alloc();
+		if (!ptr) {
+			err = -ENOMEM;
+			goto free_channels;
+		}
+		comp = &ptr->component_info;
+		ptr->frequency		= le32_to_cpu(c->frequency);
+		ptr->service_id		= le32_to_cpu(c->service_id);
+		ptr->version		= le16_to_cpu(c->version);
+		ptr->frequency_index	= c->frequency_index;
+		ptr->fic_quality	= c->fic_quality;
+		ptr->signal_strength	= c->signal_strength;
+		ptr->country_id		= c->country_id;
+		ptr->extended_country_code = c->extended_country_code;
+		ptr->is_data_service	= c->flags & SI468X_DAB_CACHE_DATA;
+		ptr->is_audio_service	= c->flags & SI468X_DAB_CACHE_AUDIO;
+		ptr->is_started		= c->flags & SI468X_DAB_CACHE_STARTED;
+		comp->dg_flag		= c->flags & SI468X_DAB_CACHE_DG;
+		comp->is_primary	= c->flags & SI468X_DAB_CACHE_PRIMARY;
+		comp->is_secondary	= c->flags & SI468X_DAB_CACHE_SECONDARY;
+		comp->access_control_flag = c->flags & SI468X_DAB_CACHE_CA;
+		comp->mua_info_valid	= c->flags & SI468X_DAB_CACHE_MUA;
+		comp->tm_id		= c->tm_id;
+		comp->sub_ch_id		= c->sub_ch_id;
+		comp->fidc_id		= c->fidc_id;
+		comp->sc_id		= c->sc_id;
+		comp->audio_service_type = c->audio_service_type;
+		comp->data_service_type	= c->data_service_type;
+		strscpy(ptr->service_label, c->service_label,
+			sizeof(ptr->service_label));
+		list_add_tail(&ptr->list, &channels);
+	}
+
+	si468x_core_dab_forget(core);
+	for (i = 0; i < nr_freqs; i++)
+		core->loaded_dab_freq_list[i].frequency = le32_to_cpu(freq[i]);
+	list_for_each_entry_safe(ptr, next, &channels, list) {
+		list_del(&ptr->list);
+		si468x_chdb_add(&core->dab_channels, ptr);
+	}
+
+	return 0;
+
+free_channels:
+	list_for_each_entry_safe(ptr, next, &channels, list) {
+		list_del(&ptr->list);
+		si468x_chdb_free(ptr);
+	}
+
+	return err;
+}
+
 static ssize_t si468x_service_list_show(struct device *dev,
 					struct device_attribute *attr,
 					char *buf)
 {
+	struct si468x_core *core = dev_get_drvdata(dev);
 	struct si468x_dab_channel *ptr;
-	sprintf(buf, "Service List:\n");
-	sprintf(buf + strlen(buf), "    low "
-				   "      high "
-				   "spacing "
-				   "(for use with v4l2-ctl --freq-seek)\n");
-	sprintf(buf + strlen(buf), "    MHz "
-				   "Service ID "
-				   "SubChId "
-				   "FIC "
-				   "Strength "
-				   "Country "
-				   "Version "
-				   "started "
-				   "Label            \n");
-	list_for_each_entry(ptr, &si468x_dab_channel_list, list) {
-		sprintf(buf + strlen(buf), "%3d.%03d %10d %7d %3d %8d %7d %7d %s %s\n",
-			ptr->frequency / 1000,
-			ptr->frequency % 1000,
-			ptr->service_id,
-			ptr->component_info.sub_ch_id,
-			ptr->fic_quality,
-			ptr->signal_strength,
-			ptr->country_id,
-			ptr->version,
-			(ptr->is_started) ? "   *   " : "   -   ",
-			ptr->service_label);
-	}
-	return strlen(buf);
-
-}static ssize_t si468x_dynamic_label_show(struct device *dev,
+	int len;
+
+	len = scnprintf(buf, PAGE_SIZE, "Service List:\n");
+	len += scnprintf(buf + len, PAGE_SIZE - len,
+			 "    low "
+			 "      high "
+			 "spacing "
+			 "(for use with v4l2-ctl --freq-seek)\n");
+	len += scnprintf(buf + len, PAGE_SIZE - len,
+			 "    MHz "
+			 "Service ID "
+			 "SubChId "
+			 "FIC "
+			 "Strength "
+			 "Country "
+			 "Version "
+			 "started "
+			 "Label            \n");
+	rcu_read_lock();
+	list_for_each_entry_rcu(ptr, &core->dab_channels.list, list) {
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "%3d.%03d %10d %7d %3d %8d %7d %7d %s %s\n",
+				 ptr->frequency / 1000,
+				 ptr->frequency % 1000,
+				 ptr->service_id,
+				 ptr->component_info.sub_ch_id,
+				 ptr->fic_quality,
+				 ptr->signal_strength,
+				 ptr->country_id,
+				 ptr->version,
+				 (ptr->is_started) ? "   *   " : "   -   ",
+				 ptr->service_label);
+	}
+	rcu_read_unlock();
+
+	return len;
+}
+
+/*
+ * sysfs hands the blob out in page sized pieces. It is exported into
+ * core->dab_cache_export when a read starts at offset 0, the later
+ * pieces come from that snapshot, so a changing cache does not tear a
+ * read.
+ */
+static ssize_t si468x_dab_cache_read(struct file *filp,
+				     struct kobject *kobj,
+				     struct bin_attribute *attr,
+				     char *buf, loff_t off, size_t count)
+{
+	struct si468x_core *core = dev_get_drvdata(kobj_to_dev(kobj));
+	ssize_t ret;
+
+	si468x_core_lock(core);
+	if (!core->dab_cache_export) {
+		core->dab_cache_export = kvzalloc(SI468X_DAB_CACHE_MAX_BYTES,
+						  GFP_KERNEL);
+		if (!core->dab_cache_export) {
+			ret = -ENOMEM;
+			goto unlock;
+		}
+		core->dab_cache_export_len = 0;
+	}
+	if (off == 0)
+		core->dab_cache_export_len =
+			si468x_core_dab_cache_export(core,
+						     core->dab_cache_export);
+
+	ret = memory_read_from_buffer(buf, count, &off,
+				      core->dab_cache_export,
+				      core->dab_cache_export_len);
+unlock:
+	si468x_core_unlock(core);
+
+	return ret;
+}
+
+/*
+ * sysfs hands the blob over in page sized pieces, it is collected in
+ * core->dab_cache_import until the size announced in the header is
+ * reached.
+ */
+static ssize_t si468x_dab_cache_write(struct file *filp,
+				      struct kobject *kobj,
+				      struct bin_attribute *attr,
+				      char *buf, loff_t off, size_t count)
+{
+	struct si468x_core *core = dev_get_drvdata(kobj_to_dev(kobj));
+	const struct si468x_dab_cache_header *hdr;
+	size_t size;
+	int err = 0;
+
+	si468x_core_lock(core);
+	if (core->power_state != SI468X_STATE_POWER_DOWN) {
+		err = -EBUSY;
+		goto unlock;
+	}
+
+	if (off == 0) {
+		kvfree(core->dab_cache_import);
+		core->dab_cache_import = kvzalloc(SI468X_DAB_CACHE_MAX_BYTES,
+						  GFP_KERNEL);
+		core->dab_cache_import_len = 0;
+		if (!core->dab_cache_import) {
+			err = -ENOMEM;
+			goto unlock;
+		}
+	} else if (!core->dab_cache_import ||
+		   off != core->dab_cache_import_len) {
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	memcpy(core->dab_cache_import + off, buf, count);
+	core->dab_cache_import_len = off + count;
+	if (core->dab_cache_import_len < sizeof(*hdr))
+		goto unlock;
+
+	hdr = (const void *)core->dab_cache_import;
+	size = si468x_core_dab_cache_size(le16_to_cpu(hdr->nr_freqs),
+					  le16_to_cpu(hdr->nr_channels));
+	if (core->dab_cache_import_len < size &&
+	    size <= SI468X_DAB_CACHE_MAX_BYTES)
+		goto unlock;
+
+	err = si468x_core_dab_cache_import(core, core->dab_cache_import,
+					   core->dab_cache_import_len);
+	kvfree(core->dab_cache_import);
+	core->dab_cache_import = NULL;
+	core->dab_cache_import_len = 0;
+unlock:
+	si468x_core_unlock(core);
+
+	return (err < 0) ? err : count;
+}
+
+static ssize_t si468x_rds_show(struct device *dev,
+			       struct device_attribute *attr,
+			       char *buf)
+{
+	struct si468x_core *core = dev_get_drvdata(dev);
+	struct si468x_rds rds;
+	ssize_t len;
+	int i;
+
+	si468x_core_read_rds(core, &rds);
+
+	len = scnprintf(buf, PAGE_SIZE,
+			"pi 0x%04x pty %u tp %d ta %d ms %d\nps %s\nrt %s\n",
+			rds.pi, rds.pty, rds.tp, rds.ta, rds.ms, rds.ps, rds.rt);
+	if (rds.ct_valid)
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "ct %u %02u:%02u %+d\n", rds.ct_mjd,
+				 rds.ct_hour, rds.ct_minute, rds.ct_offset);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "af");
+	for (i = 0; i < rds.nr_afs; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, " %u",
+				 rds.afs[i]);
+	len += scnprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	return len;
+}
+
+static void si468x_core_read_dls(struct si468x_core *core,
+				 struct si468x_dls *dls)
+{
+	unsigned int seq;
+
+	do {
+		seq = read_seqbegin(&core->dls_lock);
+		*dls = core->dls;
+	} while (read_seqretry(&core->dls_lock, seq));
+}
+
+static ssize_t si468x_dynamic_label_show(struct device *dev,
 					struct device_attribute *attr,
 					char *buf)
 {
 	struct si468x_core *core = dev_get_drvdata(dev);
+	struct si468x_dls dls;
+
+	si468x_core_read_dls(core, &dls);
+
+	return scnprintf(buf, PAGE_SIZE, "%s\n", dls.text);
+}
+
+static ssize_t si468x_dl_plus_show(struct device *dev,
+				   struct device_attribute *attr,
+				   char *buf)
+{
+	struct si468x_core *core = dev_get_drvdata(dev);
+	struct si468x_dls dls;
+	ssize_t len;
+	int i, size;
+
+	si468x_core_read_dls(core, &dls);
+
+	len = scnprintf(buf, PAGE_SIZE,
+			"change %u item_toggle %d item_running %d\n",
+			dls.change, dls.item_toggle, dls.item_running);
+	for (i = 0; i < dls.nr_tags; i++) {
+		size = strnlen(dls.text, sizeof(dls.text));
+		size = clamp(size - dls.tags[i].start, 0,
+			     (int)dls.tags[i].length);
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%u %u %u %.*s\n",
+				 dls.tags[i].content_type, dls.tags[i].start,
+				 dls.tags[i].length, size,
+				 dls.text + min_t(int, dls.tags[i].start,
+						  sizeof(dls.text) - 1));
+	}
+
+	return len;
+}
+
+/*
+ * The image is read in page sized pieces, a new image may be published
+ * in between. Readers compare the seq of si468x_slideshow_info before
+ * and after reading.
+ */
+static ssize_t si468x_slideshow_read(struct file *filp,
+				     struct kobject *kobj,
+				     struct bin_attribute *attr,
+				     char *buf, loff_t off, size_t count)
+{
+	struct si468x_core *core = dev_get_drvdata(kobj_to_dev(kobj));
+	struct si468x_mot_object *obj;
+	ssize_t ret;
+
+	rcu_read_lock();
+	obj = rcu_dereference(core->mot_image);
+	ret = memory_read_from_buffer(buf, count, &off, obj->data, obj->size);
+	rcu_read_unlock();
+
+	return ret;
+}
+
+static ssize_t si468x_slideshow_info_show(struct device *dev,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	struct si468x_core *core = dev_get_drvdata(dev);
+	struct si468x_mot_object *obj;
+	ssize_t len;
+
+	rcu_read_lock();
+	obj = rcu_dereference(core->mot_image);
+	len = scnprintf(buf, PAGE_SIZE,
+			"seq %u service 0x%08x transport 0x%04x type %u/%u size %u\n",
+			obj->seq, obj->service_id, obj->transport_id,
+			obj->content_type, obj->content_subtype, obj->size);
+	rcu_read_unlock();
+
+	return len;
+}
+
+static ssize_t si468x_band_scan_show(struct device *dev,
+				     struct device_attribute *attr,
+				     char *buf)
+{
+	struct si468x_core *core = dev_get_drvdata(dev);
+	ssize_t len;
 
 	si468x_core_lock(core);
-	snprintf(buf, SI468X_DAB_DL_PLUS_MAX_TEXT_LENGTH,
-		 "%s\n", core->si468x_dls_message);
+	len = si468x_scan_show(core, buf, PAGE_SIZE);
 	si468x_core_unlock(core);
-	return strlen(buf);
+
+	return len;
+}
+
+static ssize_t si468x_band_scan_store(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t count)
+{
+	struct si468x_core *core = dev_get_drvdata(dev);
+	int err;
+
+	if (sysfs_streq(buf, "cancel")) {
+		si468x_scan_cancel(core);
+		return count;
+	}
+
+	if (sysfs_streq(buf, "scan"))
+		err = si468x_scan_start(core, false);
+	else if (sysfs_streq(buf, "full"))
+		err = si468x_scan_start(core, true);
+	else
+		err = -EINVAL;
+
+	return (err < 0) ? err : count;
+}
+
+static ssize_t si468x_station_list_show(struct device *dev,
+					struct device_attribute *attr,
+					char *buf)
+{
+	struct si468x_core *core = dev_get_drvdata(dev);
+	struct si468x_dab_channel *ptr;
+	int len;
+
+	len = scnprintf(buf, PAGE_SIZE, "Band       kHz     PI RSSI SNR\n");
+	rcu_read_lock();
+	list_for_each_entry_rcu(ptr, &core->analog_channels.list, list) {
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "%-4s %9u 0x%04x %4d %3d\n",
+				 ptr->band == SI468X_CHDB_AM ? "AM" : "FM",
+				 ptr->frequency, ptr->service_id,
+				 (s8)READ_ONCE(ptr->signal_strength),
+				 READ_ONCE(ptr->snr));
+	}
+	rcu_read_unlock();
+
+	return len;
 }
 
 static DEVICE_ATTR_WO(si468x_nvram);
 static DEVICE_ATTR_WO(si468x_property);
 static DEVICE_ATTR_RO(si468x_service_list);
 static DEVICE_ATTR_RO(si468x_dynamic_label);
+static DEVICE_ATTR_RO(si468x_dl_plus);
+static DEVICE_ATTR_RO(si468x_rds);
+static DEVICE_ATTR_RO(si468x_slideshow_info);
+static DEVICE_ATTR_RW(si468x_band_scan);
+static DEVICE_ATTR_RO(si468x_station_list);
+static BIN_ATTR_RW(si468x_dab_cache, SI468X_DAB_CACHE_MAX_BYTES);
+static BIN_ATTR_RO(si468x_slideshow, SI468X_MOT_MAX_BODY);
 
 static struct attribute *si468x_attributes[] = {
 	&dev_attr_si468x_nvram.attr,
 	&dev_attr_si468x_property.attr,
 	&dev_attr_si468x_service_list.attr,
 	&dev_attr_si468x_dynamic_label.attr,
+	&dev_attr_si468x_dl_plus.attr,
+	&dev_attr_si468x_rds.attr,
+	&dev_attr_si468x_slideshow_info.attr,
+	&dev_attr_si468x_band_scan.attr,
+	&dev_attr_si468x_station_list.attr,
+	NULL,
+};
+
+static struct bin_attribute *si468x_bin_attributes[] = {
+	&bin_attr_si468x_dab_cache,
+	&bin_attr_si468x_slideshow,
 	NULL,
 };
 
 static const struct attribute_group si468x_attr_group = {
 	.attrs = si468x_attributes,
+	.bin_attrs = si468x_bin_attributes,
 };
 
 /**
@@ -2045,66 +3881,133 @@ int si468x_core_cmd_fm_acf_status(struct si468x_core *core,
 				  struct si468x_acf_status_report *report)
 {
 	int err;
-	u8       resp[CMD_FM_ACF_STATUS_NRESP];
-	const u8 args[CMD_FM_ACF_STATUS_NARGS] = {
-		SI468X_ACF_ACK_INT,
+	u8       resp[CMD_FM_ACF_STATUS_NRESP];
+	const u8 args[CMD_FM_ACF_STATUS_NARGS] = {
+		SI468X_ACF_ACK_INT,
+	};
+
+	if (!report)
+		return -EINVAL;
+
+	err = si468x_core_send_command(core, CMD_FM_ACF_STATUS,
+				       args, ARRAY_SIZE(args),
+				       resp, ARRAY_SIZE(resp),
+				       SI468X_DEFAULT_TIMEOUT);
+	if (err < 0)
+		return err;
+
+	report->blend_int	= resp[4] & SI468X_ACF_BLEND_INT;
+	report->hicut_int	= resp[4] & SI468X_ACF_HICUT_INT;
+	report->softmute_int	= resp[4] & SI468X_ACF_SOFTMUTE_INT;
+	report->blend_conv	= resp[5] & SI468X_ACF_BLEND_CONV;
+	report->hicut_conv	= resp[5] & SI468X_ACF_HICUT_CONV;
+	report->softmute_conv	= resp[5] & SI468X_ACF_SOFTMUTE_CONV;
+	report->blend_state	= resp[5] & SI468X_ACF_BLEND_STATE;
+	report->hicut_state	= resp[5] & SI468X_ACF_HICUT_STATE;
+	report->softmute_state	= resp[5] & SI468X_ACF_SOFTMUTE_STATE;
+	report->smattn		= resp[6] & SI468X_ACF_SMATTN;
+	report->hicut		= resp[7];
+	report->pilot		= resp[8] & SI468X_ACF_PILOT;
+	report->stblend		= resp[8] & SI468X_ACF_STBLEND;
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(si468x_core_cmd_fm_acf_status);
+
+int si468x_core_cmd_dab_acf_status(struct si468x_core *core,
+				  struct si468x_acf_status_report *report)
+{
+	int err;
+	u8       resp[CMD_DAB_ACF_STATUS_NRESP];
+	const u8 args[CMD_DAB_ACF_STATUS_NARGS] = {
+			0,
+	};
+
+	if (!report)
+		return -EINVAL;
+
+	err = si468x_core_send_command(core, CMD_DAB_ACF_STATUS,
+				       args, ARRAY_SIZE(args),
+				       resp, ARRAY_SIZE(resp),
+				       SI468X_DEFAULT_TIMEOUT);
+	if (err < 0)
+		return err;
+
+	report->rfu1		= resp[4];
+	report->rfu2		= resp[5];
+	report->audio_level	= get_unaligned_le16(resp + 6);
+	report->cmft_noise_level= get_unaligned_le16(resp + 8);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(si468x_core_cmd_dab_acf_status);
+
+/**
+ * si468x_core_cmd_test_get_rssi() - send 'TEST_GET_RSSI'
+ * @core: device to send the command to
+ * @rssi: receives the RSSI of the tuned frequency in 1/256 dBuV
+ *
+ * Function returns 0 on succsess and negative error code on
+ * failure
+ */
+int si468x_core_cmd_test_get_rssi(struct si468x_core *core, s16 *rssi)
+{
+	int err;
+	u8       resp[CMD_TEST_GET_RSSI_NRESP];
+	const u8 args[CMD_TEST_GET_RSSI_NARGS] = {
+		0,
 	};
 
-	if (!report)
-		return -EINVAL;
-
-	err = si468x_core_send_command(core, CMD_FM_ACF_STATUS,
+	err = si468x_core_send_command(core, CMD_TEST_GET_RSSI,
 				       args, ARRAY_SIZE(args),
 				       resp, ARRAY_SIZE(resp),
 				       SI468X_DEFAULT_TIMEOUT);
 	if (err < 0)
 		return err;
 
-	report->blend_int	= resp[4] & SI468X_ACF_BLEND_INT;
-	report->hicut_int	= resp[4] & SI468X_ACF_HICUT_INT;
-	report->softmute_int	= resp[4] & SI468X_ACF_SOFTMUTE_INT;
-	report->blend_conv	= resp[5] & SI468X_ACF_BLEND_CONV;
-	report->hicut_conv	= resp[5] & SI468X_ACF_HICUT_CONV;
-	report->softmute_conv	= resp[5] & SI468X_ACF_SOFTMUTE_CONV;
-	report->blend_state	= resp[5] & SI468X_ACF_BLEND_STATE;
-	report->hicut_state	= resp[5] & SI468X_ACF_HICUT_STATE;
-	report->softmute_state	= resp[5] & SI468X_ACF_SOFTMUTE_STATE;
-	report->smattn		= resp[6] & SI468X_ACF_SMATTN;
-	report->hicut		= resp[7];
-	report->pilot		= resp[8] & SI468X_ACF_PILOT;
-	report->stblend		= resp[8] & SI468X_ACF_STBLEND;
+	*rssi = (s16)get_unaligned_le16(resp + 4);
 
 	return err;
 }
-EXPORT_SYMBOL_GPL(si468x_core_cmd_fm_acf_status);
+EXPORT_SYMBOL_GPL(si468x_core_cmd_test_get_rssi);
 
-int si468x_core_cmd_dab_acf_status(struct si468x_core *core,
-				  struct si468x_acf_status_report *report)
+/**
+ * si468x_core_cmd_dab_get_audio_info() - send 'DAB_GET_AUDIO_INFO'
+ * @core:   device to send the command to
+ * @report: audio information of the running service
+ *
+ * Function returns 0 on succsess and negative error code on
+ * failure
+ */
+int si468x_core_cmd_dab_get_audio_info(struct si468x_core *core,
+				       struct si468x_dab_audio_info_report *report)
 {
 	int err;
-	u8       resp[CMD_DAB_ACF_STATUS_NRESP];
-	const u8 args[CMD_DAB_ACF_STATUS_NARGS] = {
+	u8       resp[CMD_DAB_GET_AUDIO_INFO_NRESP];
+	const u8 args[CMD_DAB_GET_AUDIO_INFO_NARGS] = {
 			0,
 	};
 
 	if (!report)
 		return -EINVAL;
 
-	err = si468x_core_send_command(core, CMD_DAB_ACF_STATUS,
+	err = si468x_core_send_command(core, CMD_DAB_GET_AUDIO_INFO,
 				       args, ARRAY_SIZE(args),
 				       resp, ARRAY_SIZE(resp),
 				       SI468X_DEFAULT_TIMEOUT);
 	if (err < 0)
 		return err;
 
-	report->rfu1		= resp[4];
-	report->rfu2		= resp[5];
-	report->audio_level	= get_unaligned_le16(resp + 6);
-	report->cmft_noise_level= get_unaligned_le16(resp + 8);
+	report->bit_rate	= get_unaligned_le16(resp + 4);
+	report->sample_rate	= get_unaligned_le16(resp + 6);
+	report->ps_flag		= 0x08 & resp[8];
+	report->sbr_flag	= 0x04 & resp[8];
+	report->mode		= 0x03 & resp[8];
+	report->drc_gain	= resp[9];
 
 	return err;
 }
-EXPORT_SYMBOL_GPL(si468x_core_cmd_dab_acf_status);
+EXPORT_SYMBOL_GPL(si468x_core_cmd_dab_get_audio_info);
 
 int si468x_core_cmd_dab_event_status(struct si468x_core *core,
 				     struct si468x_event_status_args *eventargs,
@@ -2141,11 +4044,112 @@ int si468x_core_cmd_dab_event_status(struct si468x_core *core,
 }
 EXPORT_SYMBOL_GPL(si468x_core_cmd_dab_event_status);
 
+/**
+ * si468x_core_cmd_dab_get_service_linking_info() - send
+ * 'DAB_GET_SERVICE_LINKING_INFO'
+ * @core:       device to send the command to
+ * @service_id: service id (SId) the linking sets are requested for
+ * @buf:        receives the reply from byte 6 on, the number of link sets
+ *              followed by the link sets
+ * @size:       size of @buf
+ *
+ * Each link set is the LSN (le16), a flags byte (bit 0 active, bit 1
+ * hard link, bit 2 international), a byte with the id type in bits 7:4
+ * (0 DAB SId, 1 RDS PI) and the number of ids in bits 3:0, followed by
+ * the ids (le32).
+ *
+ * Function returns the number of bytes in @buf or a negative error
+ * code.
+ */
+int si468x_core_cmd_dab_get_service_linking_info(struct si468x_core *core,
+						 u32 service_id,
+						 u8 *buf, int size)
+{
+	int err, len;
+	u8       resp[CMD_DAB_GET_SERVICE_LINKING_INFO_NRESP];
+	const u8 args[CMD_DAB_GET_SERVICE_LINKING_INFO_NARGS] = {
+		0,
+		0,
+		0,
+		service_id & 0xff,
+		(service_id >> 8) & 0xff,
+		(service_id >> 16) & 0xff,
+		(service_id >> 24) & 0xff,
+	};
+
+	err = si468x_core_send_command(core, CMD_DAB_GET_SERVICE_LINKING_INFO,
+				       args, ARRAY_SIZE(args),
+				       resp, ARRAY_SIZE(resp),
+				       SI468X_DEFAULT_TIMEOUT);
+	if (err < 0)
+		return err;
+
+	/* the size counts the bytes after its own field */
+	len = min_t(int, get_unaligned_le16(resp + 4), size);
+	if (len <= ARRAY_SIZE(resp) - 6) {
+		memcpy(buf, resp + 6, len);
+		return len;
+	}
+
+	memcpy(buf, resp + 6, ARRAY_SIZE(resp) - 6);
+	err = si468x_core_read_offset(core, ARRAY_SIZE(resp),
+				      buf + ARRAY_SIZE(resp) - 6,
+				      len - (ARRAY_SIZE(resp) - 6));
+
+	return (err < 0) ? err : len;
+}
+EXPORT_SYMBOL_GPL(si468x_core_cmd_dab_get_service_linking_info);
+
+/**
+ * si468x_core_cmd_dab_get_freq_info() - send 'DAB_GET_FREQ_INFO'
+ * @core: device to send the command to
+ * @buf:  receives the frequency information list (FIG 0/21) from byte 8
+ *        of the reply on
+ * @size: size of @buf
+ *
+ * Each entry is the id (le32), the frequency in kHz (le32), the range
+ * and modulation byte, enum si468x_fi_rnm, the continuity flag and two
+ * reserved bytes.
+ *
+ * Function returns the number of bytes in @buf or a negative error
+ * code.
+ */
+int si468x_core_cmd_dab_get_freq_info(struct si468x_core *core,
+				      u8 *buf, int size)
+{
+	int err, len;
+	u8       resp[CMD_DAB_GET_FREQ_INFO_NRESP];
+	const u8 args[CMD_DAB_GET_FREQ_INFO_NARGS] = {
+		0,
+	};
+
+	err = si468x_core_send_command(core, CMD_DAB_GET_FREQ_INFO,
+				       args, ARRAY_SIZE(args),
+				       resp, ARRAY_SIZE(resp),
+				       SI468X_DEFAULT_TIMEOUT);
+	if (err < 0)
+		return err;
+
+	len = min_t(u32, get_unaligned_le32(resp + 4), size);
+	if (len <= ARRAY_SIZE(resp) - 8) {
+		memcpy(buf, resp + 8, len);
+		return len;
+	}
+
+	memcpy(buf, resp + 8, ARRAY_SIZE(resp) - 8);
+	err = si468x_core_read_offset(core, ARRAY_SIZE(resp),
+				      buf + ARRAY_SIZE(resp) - 8,
+				      len - (ARRAY_SIZE(resp) - 8));
+
+	return (err < 0) ? err : len;
+}
+EXPORT_SYMBOL_GPL(si468x_core_cmd_dab_get_freq_info);
+
 int si468x_core_cmd_dab_get_service_list(struct si468x_core *core,
 					 struct si468x_dab_service_list *list)
 {
 	int err;
-	int srvnr, compnr, respptr;
+	int srvnr, compnr, respptr, size;
 	u8       resp[CMD_GET_DIGITAL_SERVICE_LIST_NRESP];
 	u8       *fullresp;
 	const u8 args[CMD_GET_DIGITAL_SERVICE_LIST_NARGS] = {
@@ -2159,16 +4163,18 @@ int si468x_core_cmd_dab_get_service_list(struct si468x_core *core,
 	if (err < 0 || list == NULL)
 		return err;
 
-	fullresp = kmalloc(get_unaligned_le16(resp + 4),
-			   GFP_KERNEL);
+	/* the list size counts from its own field at byte 4 */
+	size = CMD_GET_DIGITAL_SERVICE_LIST_NRESP +
+	       get_unaligned_le16(resp + 4) - 2;
+	if (size < ARRAY_SIZE(resp))
+		return -EIO;
+	fullresp = kmalloc(size, GFP_KERNEL);
 	if (!fullresp)
 		return -ENOMEM;
-	err = si468x_core_send_command(core, CMD_GET_DIGITAL_SERVICE_LIST,
-				       args, ARRAY_SIZE(args),
-				       fullresp,
-				       CMD_GET_DIGITAL_SERVICE_LIST_NRESP +
-				       get_unaligned_le16(resp + 4) - 2,
-				       SI468X_DEFAULT_TIMEOUT);
+	memcpy(fullresp, resp, ARRAY_SIZE(resp));
+	err = si468x_core_read_offset(core, ARRAY_SIZE(resp),
+				      fullresp + ARRAY_SIZE(resp),
+				      size - ARRAY_SIZE(resp));
 	if (err < 0)
 		goto free_kmem;
 
@@ -2453,50 +4459,75 @@ int si468x_core_cmd_dab_seek_start(struct si468x_core *core,
 	u32 frequency = seek->rangelow / (FREQ_MUL / 1000); /* kHz */
 	u32 service_id = seek->rangehigh / FREQ_MUL;
 	u8  sub_ch_id = seek->spacing;
-	struct si468x_dab_channel *ptr;
+	struct si468x_chdb *db = &core->dab_channels;
+	struct si468x_dab_channel *ptr, *cur = NULL;
+	ktime_t start = ktime_get();
 
-	if (list_empty(&si468x_dab_channel_list))
+	if (list_empty(&db->list))
 		return -EINVAL;
-	/* stop service first */
-	list_for_each_entry(ptr, &si468x_dab_channel_list, list) {
-		if(ptr->is_started) {
-			err = si468x_core_cmd_dab_stop_service(core,
-							       ptr);
-			if (err < 0)
-				return err;
+
+	list_for_each_entry(ptr, &db->list, list) {
+		if (ptr->is_started) {
+			cur = ptr;
 			break;
 		}
 	}
 
 	if (frequency == 0) {
-		if (seek->seek_upward) {
-			if (!list_is_last(&ptr->list, &si468x_dab_channel_list))
+		if (!cur) {
+			ptr = seek->seek_upward ?
+			      list_first_entry(&db->list,
+					       struct si468x_dab_channel, list) :
+			      list_last_entry(&db->list,
+					      struct si468x_dab_channel, list);
+		} else if (seek->seek_upward) {
+			ptr = cur;
+			if (!list_is_last(&ptr->list, &db->list))
 				ptr = list_next_entry(ptr, list);
 			else
 				if (seek->wrap_around)
-					ptr = list_first_entry(&si468x_dab_channel_list,
+					ptr = list_first_entry(&db->list,
 							struct si468x_dab_channel, list);
 		} else {
-			if (!list_is_first(&ptr->list, &si468x_dab_channel_list))
+			ptr = cur;
+			if (!list_is_first(&ptr->list, &db->list))
 				ptr = list_prev_entry(ptr, list);
 			else
 				if (seek->wrap_around)
-					ptr = list_last_entry(&si468x_dab_channel_list,
+					ptr = list_last_entry(&db->list,
 							struct si468x_dab_channel, list);
 		}
-		return si468x_core_cmd_dab_start_service(core, ptr);
+	} else {
+		ptr = si468x_chdb_find(db, frequency, service_id, sub_ch_id);
+		if (!ptr)
+			return -EINVAL;
 	}
 
-	/* find matching entry */
-	list_for_each_entry(ptr, &si468x_dab_channel_list, list) {
-		if (ptr->frequency == frequency &&
-		    ptr->service_id == service_id &&
-		    ptr->component_info.sub_ch_id == sub_ch_id) {
-			err = si468x_core_cmd_dab_start_service(core, ptr);
-			break;
+	if (cur) {
+		/*
+		 * Tuning to another ensemble stops all running services,
+		 * the service only has to be stopped within the ensemble.
+		 */
+		if (cur->frequency_index == ptr->frequency_index &&
+		    core->dab_tuned_index == cur->frequency_index) {
+			err = si468x_core_cmd_dab_stop_service(core, cur);
+			if (err < 0)
+				return err;
+		} else {
+			cur->is_started = false;
 		}
 	}
 
+	err = si468x_core_cmd_dab_start_service(core, ptr);
+	if (err < 0)
+		return err;
+
+	if (atomic_read(&core->zap_users)) {
+		core->zap_start = start;
+		mod_delayed_work(system_wq, &core->zap_work,
+				 msecs_to_jiffies(SI468X_ZAP_POLL_INTERVAL));
+	}
+
 	return err;
 }
 EXPORT_SYMBOL_GPL(si468x_core_cmd_dab_seek_start);
@@ -2519,8 +4550,9 @@ int si468x_core_cmd_am_tune_freq(struct si468x_core *core,
 }
 EXPORT_SYMBOL_GPL(si468x_core_cmd_am_tune_freq);
 
-int si468x_core_cmd_fm_tune_freq(struct si468x_core *core,
-					struct si468x_tune_freq_args *tuneargs)
+/* tunes without forgetting the RDS, for AF checks of the same program */
+int __si468x_core_cmd_fm_tune_freq(struct si468x_core *core,
+				   struct si468x_tune_freq_args *tuneargs)
 {
 	u8       resp[CMD_FM_TUNE_FREQ_NRESP];
 	const u8 args[CMD_FM_TUNE_FREQ_NARGS] = {
@@ -2537,6 +4569,14 @@ int si468x_core_cmd_fm_tune_freq(struct si468x_core *core,
 					 args, sizeof(args),
 					 resp, sizeof(resp));
 }
+
+int si468x_core_cmd_fm_tune_freq(struct si468x_core *core,
+					struct si468x_tune_freq_args *tuneargs)
+{
+	si468x_rds_reset(core);
+
+	return __si468x_core_cmd_fm_tune_freq(core, tuneargs);
+}
 EXPORT_SYMBOL_GPL(si468x_core_cmd_fm_tune_freq);
 
 int si468x_core_cmd_dab_tune_freq(struct si468x_core *core,
@@ -2551,15 +4591,18 @@ int si468x_core_cmd_dab_tune_freq(struct si468x_core *core,
 		msb(tuneargs->antcap),
 	};
 	int i = 0;
+	int err;
 
 	do {
 		if (tuneargs->dab_freq_list[i].frequency ==
 		    tuneargs->freq) {
 			args[1] = i;
-			return si468x_cmd_tune_seek_freq(core,
-							 CMD_DAB_TUNE_FREQ,
-							 args, sizeof(args),
-							 resp, sizeof(resp));
+			err = si468x_cmd_tune_seek_freq(core,
+							CMD_DAB_TUNE_FREQ,
+							args, sizeof(args),
+							resp, sizeof(resp));
+			core->dab_tuned_index = (err < 0) ? -1 : i;
+			return err;
 		    }
 		i++;
 	} while (tuneargs->dab_freq_list[i].frequency &&
@@ -2578,6 +4621,9 @@ int si468x_core_cmd_dab_set_freq_list(struct si468x_core *core,
 	char *tx_buf;
 	u8   resp[CMD_DAB_SET_FREQ_LIST_NRESP];
 
+	/* indexes of the old list are meaningless now */
+	core->dab_tuned_index = -1;
+
 	tx_buf = kmalloc(CMD_DAB_SET_FREQ_LIST_NARGS + dab_freq_list_length * 4,
 			 GFP_KERNEL);
 	if (!tx_buf)
@@ -2695,6 +4741,347 @@ int si468x_core_cmd_agc_status(struct si468x_core *core,
 }
 EXPORT_SYMBOL_GPL(si468x_core_cmd_agc_status);
 
+/*
+ * Commands the chip answers within microseconds. Polling for CTS saves
+ * the round trip through the interrupt thread.
+ */
+static const u8 si468x_fast_commands[] = {
+	CMD_GET_PART_INFO,
+	CMD_GET_SYS_STATE,
+	CMD_GET_POWER_UP_ARGS,
+	CMD_GET_FUNC_INFO,
+	CMD_SET_PROPERTY,
+	CMD_GET_PROPERTY,
+	CMD_GET_AGC_STATUS,
+	CMD_FM_RSQ_STATUS,
+	CMD_FM_RDS_STATUS,
+	CMD_FM_RDS_BLOCKCOUNT,
+	CMD_AM_RSQ_STATUS,
+	CMD_DAB_DIGRAD_STATUS,
+	CMD_DAB_GET_EVENT_STATUS,
+	CMD_DAB_GET_AUDIO_INFO,
+	CMD_TEST_GET_RSSI,
+	CMD_READ_OFFSET,
+};
+
+static void si468x_core_init_cmd_policy(struct si468x_core *core)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(si468x_fast_commands); i++)
+		core->cmd_stats[si468x_fast_commands[i]].poll_usecs =
+			SI468X_FAST_CMD_POLL_USECS;
+}
+
+static ssize_t si468x_core_read_cmd_poll(struct file *file,
+					 char __user *user_buf,
+					 size_t count, loff_t *ppos)
+{
+	struct si468x_core *core = file->private_data;
+	struct si468x_cmd_stats *stats;
+	size_t size = SI468X_CMD_OPCODES * 64;
+	ssize_t len = 0;
+	char *buf;
+	int i;
+
+	buf = kmalloc(size, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	len += scnprintf(buf + len, size - len,
+			 "opcode poll_usecs polled poll_timeouts irq_waits\n");
+	for (i = 0; i < SI468X_CMD_OPCODES; i++) {
+		stats = &core->cmd_stats[i];
+		if (!stats->poll_usecs && !stats->polled &&
+		    !stats->poll_timeouts && !stats->irq_waits)
+			continue;
+		len += scnprintf(buf + len, size - len,
+				 "0x%02x %u %u %u %u\n", i,
+				 stats->poll_usecs, stats->polled,
+				 stats->poll_timeouts, stats->irq_waits);
+	}
+
+	len = simple_read_from_buffer(user_buf, count, ppos, buf, len);
+	kfree(buf);
+
+	return len;
+}
+
+/* "<opcode> <usecs>" sets the poll budget of a command, 0 disables polling */
+static ssize_t si468x_core_write_cmd_poll(struct file *file,
+					  const char __user *user_buf,
+					  size_t count, loff_t *ppos)
+{
+	struct si468x_core *core = file->private_data;
+	unsigned int opcode, usecs;
+	char buf[32];
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, user_buf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	if (sscanf(buf, "%i %u", &opcode, &usecs) != 2 ||
+	    opcode >= SI468X_CMD_OPCODES ||
+	    usecs > SI468X_DEFAULT_TIMEOUT)
+		return -EINVAL;
+
+	si468x_core_lock(core);
+	core->cmd_stats[opcode].poll_usecs = usecs;
+	si468x_core_unlock(core);
+
+	return count;
+}
+
+static const struct file_operations si468x_core_cmd_poll_fops = {
+	.open	= simple_open,
+	.llseek = default_llseek,
+	.read	= si468x_core_read_cmd_poll,
+	.write	= si468x_core_write_cmd_poll,
+};
+
+static ssize_t si468x_core_read_prop_sync(struct file *file,
+					  char __user *user_buf,
+					  size_t count, loff_t *ppos)
+{
+	struct si468x_core *core = file->private_data;
+	char buf[64];
+	int len;
+
+	si468x_core_lock(core);
+	len = scnprintf(buf, sizeof(buf), "%u properties in %lld us\n",
+			core->prop_sync_count, core->prop_sync_usecs);
+	si468x_core_unlock(core);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+static const struct file_operations si468x_core_prop_sync_fops = {
+	.open	= simple_open,
+	.llseek = default_llseek,
+	.read	= si468x_core_read_prop_sync,
+};
+
+static ssize_t si468x_core_read_prop_sync_bench(struct file *file,
+						char __user *user_buf,
+						size_t count, loff_t *ppos)
+{
+	struct si468x_core *core = file->private_data;
+	char buf[sizeof(core->prop_bench_report)];
+	int len;
+
+	si468x_core_lock(core);
+	len = strscpy(buf, core->prop_bench_report, sizeof(buf));
+	si468x_core_unlock(core);
+	if (len < 0)
+		len = 0;
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+/* writing 1 runs the benchmark, it changes the properties of the chip */
+static ssize_t si468x_core_write_prop_sync_bench(struct file *file,
+						 const char __user *user_buf,
+						 size_t count, loff_t *ppos)
+{
+	struct si468x_core *core = file->private_data;
+	bool run;
+	int err;
+
+	err = kstrtobool_from_user(user_buf, count, &run);
+	if (err < 0)
+		return err;
+	if (!run)
+		return -EINVAL;
+
+	si468x_core_lock(core);
+	err = si468x_core_bench_properties(core, core->prop_bench_report,
+					   sizeof(core->prop_bench_report));
+	if (err < 0)
+		core->prop_bench_report[0] = '\0';
+	si468x_core_unlock(core);
+
+	return (err < 0) ? err : count;
+}
+
+static const struct file_operations si468x_core_prop_sync_bench_fops = {
+	.open	= simple_open,
+	.llseek = default_llseek,
+	.read	= si468x_core_read_prop_sync_bench,
+	.write	= si468x_core_write_prop_sync_bench,
+};
+
+static int si468x_core_open_dab_zap(struct inode *inode, struct file *file)
+{
+	struct si468x_core *core = inode->i_private;
+
+	file->private_data = core;
+	atomic_inc(&core->zap_users);
+
+	return 0;
+}
+
+static int si468x_core_release_dab_zap(struct inode *inode,
+				       struct file *file)
+{
+	struct si468x_core *core = file->private_data;
+
+	if (atomic_dec_and_test(&core->zap_users))
+		cancel_delayed_work(&core->zap_work);
+
+	return 0;
+}
+
+static ssize_t si468x_core_read_dab_zap(struct file *file,
+					char __user *user_buf,
+					size_t count, loff_t *ppos)
+{
+	struct si468x_core *core = file->private_data;
+	char buf[128];
+	int len;
+
+	si468x_core_lock(core);
+	len = scnprintf(buf, sizeof(buf),
+			"zaps %u timeouts %u last %lld us min %lld us max %lld us\n",
+			core->zap_count, core->zap_timeouts, core->zap_last_us,
+			core->zap_min_us, core->zap_max_us);
+	si468x_core_unlock(core);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+static const struct file_operations si468x_core_dab_zap_fops = {
+	.open		= si468x_core_open_dab_zap,
+	.release	= si468x_core_release_dab_zap,
+	.llseek		= default_llseek,
+	.read		= si468x_core_read_dab_zap,
+};
+
+static ssize_t si468x_core_read_rds_coalesce(struct file *file,
+					     char __user *user_buf,
+					     size_t count, loff_t *ppos)
+{
+	struct si468x_core *core = file->private_data;
+	char buf[128];
+	int len;
+
+	si468x_core_lock(core);
+	len = scnprintf(buf, sizeof(buf),
+			"latency %u ms rate %u.%03u groups/s fifo_count %d interrupts %u changes %u\n",
+			core->rds_latency_ms, core->rds_rate / 1000,
+			core->rds_rate % 1000, core->rds_fifo_depth,
+			core->rds_interrupts, core->rds_depth_changes);
+	si468x_core_unlock(core);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+static const struct file_operations si468x_core_rds_coalesce_fops = {
+	.open	= simple_open,
+	.llseek = default_llseek,
+	.read	= si468x_core_read_rds_coalesce,
+};
+
+static ssize_t si468x_core_read_follow(struct file *file,
+				       char __user *user_buf,
+				       size_t count, loff_t *ppos)
+{
+	struct si468x_core *core = file->private_data;
+	char *buf;
+	int len;
+
+	buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	si468x_core_lock(core);
+	len = si468x_follow_show(core, buf, PAGE_SIZE);
+	si468x_core_unlock(core);
+
+	len = simple_read_from_buffer(user_buf, count, ppos, buf, len);
+	kfree(buf);
+
+	return len;
+}
+
+static const struct file_operations si468x_core_follow_fops = {
+	.open	= simple_open,
+	.llseek = default_llseek,
+	.read	= si468x_core_read_follow,
+};
+
+static ssize_t si468x_core_read_af(struct file *file,
+				   char __user *user_buf,
+				   size_t count, loff_t *ppos)
+{
+	struct si468x_core *core = file->private_data;
+	char buf[256];
+	int len;
+
+	si468x_core_lock(core);
+	len = si468x_af_show(core, buf, sizeof(buf));
+	si468x_core_unlock(core);
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+static const struct file_operations si468x_core_af_fops = {
+	.open	= simple_open,
+	.llseek = default_llseek,
+	.read	= si468x_core_read_af,
+};
+
+static void si468x_core_init_debugfs(struct si468x_core *core)
+{
+	struct dentry *dentry;
+
+	dentry = debugfs_create_dir(dev_name(core->dev), NULL);
+	if (IS_ERR_OR_NULL(dentry)) {
+		dev_warn(core->dev, "Could not create debugfs interface\n");
+		return;
+	}
+	core->debugfs = dentry;
+
+	debugfs_create_atomic_t("fw_cache_hits", S_IRUGO,
+				core->debugfs, &core->fw_cache_hits);
+	debugfs_create_atomic_t("fw_cache_misses", S_IRUGO,
+				core->debugfs, &core->fw_cache_misses);
+	debugfs_create_file("cmd_poll", S_IRUGO | S_IWUSR,
+			    core->debugfs, core, &si468x_core_cmd_poll_fops);
+	debugfs_create_u32("dab_svrlist_fetches", S_IRUGO,
+			   core->debugfs, &core->dab_svrlist_fetches);
+	debugfs_create_u32("dab_svrlist_skips", S_IRUGO,
+			   core->debugfs, &core->dab_svrlist_skips);
+	debugfs_create_u32("dsrv_records", S_IRUGO,
+			   core->debugfs, &core->dsrv_records);
+	debugfs_create_u32("dsrv_drops", S_IRUGO,
+			   core->debugfs, &core->dsrv_drops);
+	debugfs_create_u32("mot_evictions", S_IRUGO,
+			   core->debugfs, &core->mot_evictions);
+	debugfs_create_u32("mot_errors", S_IRUGO,
+			   core->debugfs, &core->mot_errors);
+	debugfs_create_file("follow", S_IRUGO,
+			    core->debugfs, core, &si468x_core_follow_fops);
+	debugfs_create_file("af", S_IRUGO,
+			    core->debugfs, core, &si468x_core_af_fops);
+	debugfs_create_u32("rds_overruns", S_IRUGO,
+			   core->debugfs, &core->rds_overruns);
+	debugfs_create_u32("rds_groups", S_IRUGO,
+			   core->debugfs, &core->rds_groups);
+	debugfs_create_u32("rds_bad_groups", S_IRUGO,
+			   core->debugfs, &core->rds_bad_groups);
+	debugfs_create_file("rds_coalesce", S_IRUGO,
+			    core->debugfs, core, &si468x_core_rds_coalesce_fops);
+	debugfs_create_file("dab_zap", S_IRUGO,
+			    core->debugfs, core, &si468x_core_dab_zap_fops);
+	debugfs_create_file("prop_sync", S_IRUGO,
+			    core->debugfs, core, &si468x_core_prop_sync_fops);
+	debugfs_create_file("prop_sync_bench", S_IRUSR | S_IWUSR,
+			    core->debugfs, core,
+			    &si468x_core_prop_sync_bench_fops);
+}
+
 struct si468x_core *si468x_core_probe(struct device *dev, int irq,
 				      const struct si468x_bus_ops *bus_ops)
 {
@@ -2704,6 +5091,7 @@ struct si468x_core *si468x_core_probe(struct device *dev, int irq,
 	struct device_node *node = dev->of_node;
 	struct clk         *clk;
 	int                cell_num;
+	int                i;
 	unsigned long      freq;
 
 	core = devm_kzalloc(dev, sizeof(*core), GFP_KERNEL);
@@ -2732,9 +5120,8 @@ struct si468x_core *si468x_core_probe(struct device *dev, int irq,
 	core->gpio_reset = devm_gpiod_get(core->dev, "reset", GPIOD_OUT_HIGH);
 	if (IS_ERR(core->gpio_reset)) {
 		dev_err(core->dev, "Unable to retrieve reset gpio\n");
-		rval = PTR_ERR(core->dev);
-		goto free_kfifo;
-		}
+		return ERR_CAST(core->gpio_reset);
+	}
 
 	core->supplies[0].supply = "vcore";
 	core->supplies[1].supply = "va";
@@ -2753,20 +5140,19 @@ struct si468x_core *si468x_core_probe(struct device *dev, int irq,
 	init_waitqueue_head(&core->command);
 	init_waitqueue_head(&core->tuning);
 
-	rval = kfifo_alloc(&core->rds_fifo,
-			   SI468X_DRIVER_RDS_FIFO_DEPTH *
-			   sizeof(struct v4l2_rds_data),
-			   GFP_KERNEL);
-	if (rval) {
-		dev_err(core->dev, "Could not allocate the FIFO\n");
-		return ERR_PTR(rval);
-	}
+	core->rds_ring = devm_kcalloc(core->dev, SI468X_RDS_RING_BLOCKS,
+				      sizeof(*core->rds_ring), GFP_KERNEL);
+	if (!core->rds_ring)
+		return ERR_PTR(-ENOMEM);
+	spin_lock_init(&core->rds_ring_lock);
+	/* idle until somebody reads the blocks */
+	core->rds_last_read = jiffies - msecs_to_jiffies(SI468X_RDS_IDLE_TIME);
 
 	clk = devm_clk_get(core->dev, NULL);
 	if (IS_ERR(clk)) {
 		rval = PTR_ERR(clk);
 		dev_err(core->dev, "Cannot get clock %d\n", rval);
-		goto free_kfifo;
+		return ERR_PTR(rval);
 	} else {
 		freq = clk_get_rate(clk);
 	}
@@ -2816,15 +5202,72 @@ struct si468x_core *si468x_core_probe(struct device *dev, int irq,
 		dev_info(core->dev, "Using default clock CTUN (0)\n");
 	}
 
-	mutex_init(&core->rds_drainer_status_lock);
+	if (of_property_read_u32(node, "host-load-chunk-size",
+				 &core->host_load_chunk)) {
+		core->host_load_chunk = SI468X_MAX_HOST_LOAD_BYTES;
+	} else if (!core->host_load_chunk ||
+		   core->host_load_chunk > SI468X_MAX_HOST_LOAD_CHUNK ||
+		   core->host_load_chunk % 4) {
+		dev_warn(core->dev, "Invalid host-load-chunk-size %u, using %d\n",
+			 core->host_load_chunk, SI468X_MAX_HOST_LOAD_BYTES);
+		core->host_load_chunk = SI468X_MAX_HOST_LOAD_BYTES;
+	}
+	core->fw_auto_mirror = of_property_read_bool(node,
+						     "firmware-auto-mirror");
+
+	BUILD_BUG_ON(CMD_READ_OFFSET_NRESP - 1 + SI468X_READ_OFFSET_CHUNK >
+		     SI468X_MAX_BUS_REPLY_BYTES);
+	core->bus_tx_buf = devm_kzalloc(core->dev, SI468X_BUS_BUF_BYTES,
+					GFP_KERNEL);
+	core->bus_rx_buf = devm_kzalloc(core->dev, SI468X_BUS_BUF_BYTES,
+					GFP_KERNEL);
+	if (!core->bus_tx_buf || !core->bus_rx_buf)
+		return ERR_PTR(-ENOMEM);
+
+	core->load_buf = devm_kmalloc(core->dev,
+				      SI468X_LOAD_HDR_MAX + core->host_load_chunk,
+				      GFP_KERNEL);
+	if (!core->load_buf)
+		return ERR_PTR(-ENOMEM);
+
+	core->read_offset_buf = devm_kmalloc(core->dev,
+					     CMD_READ_OFFSET_NRESP - 1 +
+					     SI468X_READ_OFFSET_CHUNK,
+					     GFP_KERNEL);
+	if (!core->read_offset_buf)
+		return ERR_PTR(-ENOMEM);
+
+	mutex_init(&core->bus_lock);
+	si468x_chdb_init(&core->dab_channels);
+	memset(core->dab_svrlist_version, 0xff,
+	       sizeof(core->dab_svrlist_version));
 	init_waitqueue_head(&core->rds_read_queue);
-	INIT_WORK(&core->rds_fifo_drainer, si468x_core_drain_rds_fifo);
+	BLOCKING_INIT_NOTIFIER_HEAD(&core->notifier);
+	seqlock_init(&core->rds_lock);
+	seqlock_init(&core->dls_lock);
 
-	INIT_WORK(&core->update_service_list,
-		  si468x_core_new_digital_service_list);
-	mutex_init(&core->digital_service_drainer_status_lock);
-	INIT_WORK(&core->update_service_data,
-		  si468x_core_new_digital_service_data);
+	core->cmd_wq = alloc_ordered_workqueue("%s", 0, dev_name(dev));
+	if (!core->cmd_wq)
+		return ERR_PTR(-ENOMEM);
+	spin_lock_init(&core->cmd_queue_lock);
+	for (i = 0; i < SI468X_PRIO_COUNT; i++)
+		INIT_LIST_HEAD(&core->cmd_queue[i]);
+	init_waitqueue_head(&core->cmd_lock_idle);
+	INIT_WORK(&core->cmd_dispatcher, si468x_core_dispatch);
+
+	core->rds_drain_req.prio = SI468X_PRIO_DATA;
+	core->rds_drain_req.fn = si468x_core_drain_rds_fifo;
+	core->service_data_req.prio = SI468X_PRIO_DATA;
+	core->service_data_req.fn = si468x_core_new_digital_service_data;
+	core->service_list_req.prio = SI468X_PRIO_STATUS;
+	core->service_list_req.fn = si468x_core_new_digital_service_list;
+	INIT_WORK(&core->nvm_mirror_work, si468x_core_mirror_nvm);
+	INIT_DELAYED_WORK(&core->status_poll, si468x_core_poll_status);
+	INIT_DELAYED_WORK(&core->zap_work, si468x_core_zap_poll);
+	si468x_follow_init(core);
+	si468x_af_init(core);
+	si468x_scan_init(core);
+	core->dab_tuned_index = -1;
 
 	if (irq) {
 		rval = devm_request_threaded_irq(core->dev,
@@ -2836,24 +5279,25 @@ struct si468x_core *si468x_core_probe(struct device *dev, int irq,
 		if (rval < 0) {
 			dev_err(core->dev, "Could not request IRQ %d\n",
 				irq);
-			goto free_kfifo;
+			goto release;
 		}
 		core->irq = irq;
 		disable_irq(irq);
 		dev_dbg(core->dev, "IRQ requested.\n");
-
-		core->rds_fifo_depth = 20;
 	} else {
-		dev_err(core->dev,
-			"No IRQ number specified\n");
-		rval = -EINVAL;
-		goto free_kfifo;
+		dev_info(core->dev,
+			 "No IRQ number specified, polling the status\n");
 	}
+	core->rds_latency_ms = SI468X_RDS_LATENCY_DEFAULT;
+	si468x_core_reset_rds_rate(core);
+	si468x_core_init_cmd_policy(core);
+
+	si468x_core_load_fw_cache(core);
 
 	rval = si468x_core_get_revision_info(core);
 	if (rval < 0) {
 		rval = -ENODEV;
-		goto free_kfifo;
+		goto release;
 	}
 
 	cell_num = 0;
@@ -2866,20 +5310,40 @@ struct si468x_core *si468x_core_probe(struct device *dev, int irq,
 	cell->name = "si468x-codec";
 	cell_num++;
 
+	rval = si468x_mot_init(core);
+	if (rval < 0)
+		goto release;
+
+	rval = si468x_dsrv_init(core);
+	if (rval < 0)
+		goto exit_mot;
+
 	rval = devm_mfd_add_devices(core->dev,
 				    0,
 				    core->cells, cell_num,
 				    NULL, 0, NULL);
 	if (rval < 0)
-		goto free_kfifo;
+		goto exit_dsrv;
 
 	rval = sysfs_create_group(&core->dev->kobj, &si468x_attr_group);
 
-	if (!rval)
+	if (!rval) {
+		si468x_core_init_debugfs(core);
 		return core;
+	}
 
-free_kfifo:
-	kfifo_free(&core->rds_fifo);
+exit_dsrv:
+	si468x_dsrv_exit(core);
+exit_mot:
+	si468x_mot_exit(core);
+release:
+	cancel_delayed_work_sync(&core->zap_work);
+	si468x_follow_exit(core);
+	si468x_af_exit(core);
+	si468x_scan_exit(core);
+	destroy_workqueue(core->cmd_wq);
+	cancel_work_sync(&core->nvm_mirror_work);
+	si468x_core_release_fw_cache(core);
 
 	return ERR_PTR(rval);
 }
@@ -2891,9 +5355,24 @@ int si468x_core_remove(struct si468x_core *core)
 
 	si468x_core_pronounce_dead(core);
 
-	disable_irq(core->irq);
-
-	kfifo_free(&core->rds_fifo);
+	if (core->irq)
+		disable_irq(core->irq);
+	cancel_delayed_work_sync(&core->status_poll);
+	cancel_delayed_work_sync(&core->zap_work);
+	si468x_follow_exit(core);
+	si468x_af_exit(core);
+	si468x_scan_exit(core);
+
+	cancel_work_sync(&core->nvm_mirror_work);
+	destroy_workqueue(core->cmd_wq);
+	debugfs_remove_recursive(core->debugfs);
+
+	si468x_dsrv_exit(core);
+	si468x_mot_exit(core);
+	si468x_chdb_clear(&core->dab_channels);
+	kvfree(core->dab_cache_import);
+	kvfree(core->dab_cache_export);
+	si468x_core_release_fw_cache(core);
 
 	return 0;
 }
@@ -323,21 +323,168 @@
 #define CMD_MAX_ARGS_COUNT				(15)
 #define CMD_MAX_RESP_COUNT				(44)
 
-#define SI468X_DRIVER_RDS_FIFO_DEPTH	128
+/* command byte and the longest header sent in front of a data block */
+#define SI468X_LOAD_HDR_MAX		(1 + CMD_FLASH_LOAD_NARGS + 4)
+/* erase granularity of the flash attached to the chip */
+#define SI468X_NVM_SECTOR_SIZE		4096
+/* delay between two status reads while polling for CTS (in usecs) */
+#define SI468X_POLL_INTERVAL		50
+/* default CTS poll budget of commands the chip answers at once (in usecs) */
+#define SI468X_FAST_CMD_POLL_USECS	200
+/* delay between two status reads while streaming properties (in usecs) */
+#define SI468X_PROP_SYNC_POLL_INTERVAL	10
+/* audio info poll period after a DAB service change (in msecs) */
+#define SI468X_ZAP_POLL_INTERVAL	10
+/* give up waiting for audio after a DAB service change (in msecs) */
+#define SI468X_ZAP_TIMEOUT		3000
+/* RDS groups read per drainer request before other requests may run */
+#define SI468X_RDS_DRAIN_BATCH		4
+/* group rate of a station sending RDS only (in groups per 1000 s) */
+#define SI468X_RDS_NOMINAL_RATE		11400
+/* largest FM_RDS_INTERRUPT_FIFO_COUNT the drainer sets */
+#define SI468X_RDS_MAX_FIFO_COUNT	20
+/* the FIFO count is raised only by this many groups or more */
+#define SI468X_RDS_COUNT_HYSTERESIS	2
+/* highest block error level (BLE) of blocks the RDS decoder uses */
+#define SI468X_RDS_MAX_BLE		1
+/* RDS is idle without a read() of the blocks for this long (in msecs) */
+#define SI468X_RDS_IDLE_TIME		10000
+/* poll interval while waiting for the PI code after a tune (msecs) */
+#define SI468X_RDS_PI_POLL		20
+/* status poll period on boards without interrupt line (in msecs) */
+#define SI468X_STATUS_POLL_INTERVAL	100
+
+/* RDS blocks kept for the readers, a power of two of whole groups */
+#define SI468X_RDS_RING_BLOCKS		512
+
+/* "SIDC", first word of the DAB cache blob */
+#define SI468X_DAB_CACHE_MAGIC		0x43444953
+#define SI468X_DAB_CACHE_VERSION	1
+/* services kept in the DAB cache blob */
+#define SI468X_DAB_CACHE_MAX_CHANNELS	512
+
+/**
+ * struct si468x_dab_cache_header - header of the DAB cache blob
+ * @magic: SI468X_DAB_CACHE_MAGIC
+ * @version: SI468X_DAB_CACHE_VERSION, other versions are rejected
+ * @nr_freqs: number of frequencies following the header
+ * @nr_channels: number of struct si468x_dab_cache_channel following
+ * the frequencies
+ * @reserved: zero
+ * @crc: crc32 of everything after the header
+ *
+ * All fields are little endian. The header is followed by @nr_freqs
+ * __le32 frequencies in kHz, in the order they are loaded into the
+ * chip, and the services.
+ */
+struct si468x_dab_cache_header {
+	__le32 magic;
+	__le16 version;
+	__le16 nr_freqs;
+	__le16 nr_channels;
+	__le16 reserved;
+	__le32 crc;
+} __packed;
+
+#define SI468X_DAB_CACHE_DATA		BIT(0)
+#define SI468X_DAB_CACHE_AUDIO		BIT(1)
+#define SI468X_DAB_CACHE_STARTED	BIT(2)
+#define SI468X_DAB_CACHE_DG		BIT(3)
+#define SI468X_DAB_CACHE_PRIMARY	BIT(4)
+#define SI468X_DAB_CACHE_SECONDARY	BIT(5)
+#define SI468X_DAB_CACHE_CA		BIT(6)
+#define SI468X_DAB_CACHE_MUA		BIT(7)
+
+/**
+ * struct si468x_dab_cache_channel - one struct si468x_dab_channel in
+ * the DAB cache blob
+ * @flags: SI468X_DAB_CACHE_* flags of the service and its component
+ *
+ * The other fields are the ones of struct si468x_dab_channel and
+ * struct si468x_dab_component_info.
+ */
+struct si468x_dab_cache_channel {
+	__le32 frequency;
+	__le32 service_id;
+	__le16 version;
+	u8     frequency_index;
+	u8     fic_quality;
+	u8     signal_strength;
+	u8     country_id;
+	u8     extended_country_code;
+	u8     flags;
+	u8     tm_id;
+	u8     sub_ch_id;
+	u8     fidc_id;
+	u8     sc_id;
+	u8     audio_service_type;
+	u8     data_service_type;
+	char   service_label[16 + 1];
+} __packed;
+
+#define SI468X_DAB_CACHE_MAX_BYTES					\
+	(sizeof(struct si468x_dab_cache_header) +			\
+	 SI468X_DAB_MAX_FREQUENCIES * sizeof(__le32) +			\
+	 SI468X_DAB_CACHE_MAX_CHANNELS *					\
+	 sizeof(struct si468x_dab_cache_channel))
 #define SI468X_SERVICE_DATA_MAX_LENGTH	0x10000
+/* bounds of the data service ring, the DT property data-ring-size */
+#define SI468X_DSRV_RING_MIN		(4 * SI468X_SERVICE_DATA_MAX_LENGTH)
+#define SI468X_DSRV_RING_MAX		(4 << 20)
+#define SI468X_DSRV_RING_DEFAULT	(256 << 10)
+/* data_src of GET_DIGITAL_SERVICE_DATA for DLS PAD */
+#define SI468X_DATA_SRC_DLS		2
+/* DLS prefix, ETSI EN 300 401 7.4.5.2 */
+#define SI468X_DLS_TOGGLE		0x80
+#define SI468X_DLS_C_FLAG		0x10
+#define SI468X_DLS_COMMAND		0x0f
+#define SI468X_DLS_CMD_CLEAR		0x01
+#define SI468X_DLS_CMD_DL_PLUS		0x02
+/* DL Plus tags command, ETSI TS 102 980 7.1 */
+#define SI468X_DL_PLUS_IT		0x08
+#define SI468X_DL_PLUS_IR		0x04
+#define SI468X_DL_PLUS_NT		0x03
+/* reception has to stay degraded this long before following (msecs) */
+#define SI468X_FOLLOW_HOLDOFF		300
+/* FIC quality in percent below which the reception is degraded */
+#define SI468X_FOLLOW_MIN_FIC_QUALITY	70
+/* linked ensembles tried before falling back to FM */
+#define SI468X_FOLLOW_MAX_TRIES		3
+/* largest DAB_GET_SERVICE_LINKING_INFO and DAB_GET_FREQ_INFO replies */
+#define SI468X_FOLLOW_MAX_REPLY		512
+/* FM reception has to stay degraded this long before checking AFs (msecs) */
+#define SI468X_AF_HOLDOFF		500
+/* no new check this long after one found nothing better (msecs) */
+#define SI468X_AF_QUIET_TIME		10000
+/* alternative frequencies measured per check */
+#define SI468X_AF_MAX_CHECKS		6
+/* an AF has to be this much stronger than the tuned frequency (dB) */
+#define SI468X_AF_MIN_GAIN		6
+/* time the chip gets to decode the PI code of an AF (msecs) */
+#define SI468X_AF_PI_TIMEOUT		300
+/* stations a band scan keeps per band */
+#define SI468X_SCAN_MAX_STATIONS	256
+/* time the chip gets to decode the PI code of a station found (msecs) */
+#define SI468X_SCAN_PI_TIMEOUT		500
+/* user application type of the MOT slideshow */
+#define SI468X_UATYPE_MOT_SLIDESHOW	0x002
+/* objects reassembled in parallel */
+#define SI468X_MOT_SLOTS		4
+/* largest MOT body kept, slides are limited to 50 KiB */
+#define SI468X_MOT_MAX_BODY		0x10000
+/* largest MSC data group, 8191 bytes data field plus headers and CRC */
+#define SI468X_MOT_MAX_DG		(8191 + 16)
+/* MOT segments tracked per object */
+#define SI468X_MOT_MAX_SEGS		1024
+/* partial objects without new segments are dropped (in msecs) */
+#define SI468X_MOT_STALE_TIME		60000
 
 enum si468x_load_firmware_to {
 	SI468X_LOAD_TO_HOST  = true,
 	SI468X_LOAD_TO_FLASH = false,
 };
 
-const char *si468x_func_string_table[] = {
-	[SI468X_FUNC_BOOTLOADER]   = "patch",
-	[SI468X_FUNC_AM_RECEIVER]  = "am",
-	[SI468X_FUNC_FM_RECEIVER]  = "fm",
-	[SI468X_FUNC_DAB_RECEIVER] = "dab",
-	[SI468X_FUNC_MINI_BOOT]    = "mini",
-};
+extern const char * const si468x_func_string_table[];
 
 enum si468x_acf_irq_ack_bits {
 	SI468X_ACF_ACK_INT	= BIT(0),
@@ -418,8 +565,105 @@ struct si468x_digital_service_data_status_report {
 	u8   *payload;
 };
 
-static inline void si468x_core_start_rds_drainer_once(struct si468x_core *);
-static inline void si468x_core_get_digital_service_list(struct si468x_core *);
-static inline void si468x_core_get_digital_service_data(struct si468x_core *);
+/**
+ * struct si468x_dsrv_stream - ring of the data service character device
+ * @kref: held by the core and by the open file
+ * @ring: control block followed by the record area, shared with the
+ * reader through mmap
+ * @data: record area of @ring
+ * @size: bytes of @data, a power of two
+ * @open: the character device is open, packets are only stored while
+ * it is
+ * @dead: the core was removed, the open file only fails
+ * @wait: readers waiting for packets
+ * @read_lock: serializes read() of the character device
+ */
+struct si468x_dsrv_stream {
+	struct kref kref;
+	struct si468x_dsrv_ring *ring;
+	u8   *data;
+	u32  size;
+	atomic_t open;
+	bool dead;
+	wait_queue_head_t wait;
+	struct mutex read_lock;
+};
+
+/**
+ * struct si468x_mot_slot - MOT object under reassembly
+ * @obj: preallocated buffer the body is collected in
+ * @used: the slot holds an object
+ * @service_id: service the object is transported in
+ * @transport_id: MOT transport id of the object
+ * @header_done: the MOT header was received
+ * @body_size: size of the body announced in the header
+ * @seg_size: size of all but the last body segment, 0 if unknown
+ * @last_seg: number of the last body segment, -1 if unknown
+ * @segs: body segments received
+ * @updated: jiffies of the last segment
+ */
+struct si468x_mot_slot {
+	struct si468x_mot_object *obj;
+	bool used;
+	u32  service_id;
+	u16  transport_id;
+	bool header_done;
+	u32  body_size;
+	u16  seg_size;
+	int  last_seg;
+	DECLARE_BITMAP(segs, SI468X_MOT_MAX_SEGS);
+	unsigned long updated;
+};
+
+int __si468x_core_cmd_fm_tune_freq(struct si468x_core *,
+				   struct si468x_tune_freq_args *);
+
+/* -------------------- si468x-af.c ----------------------- */
+
+void si468x_af_init(struct si468x_core *);
+void si468x_af_exit(struct si468x_core *);
+void si468x_af_degraded(struct si468x_core *);
+int si468x_af_show(struct si468x_core *, char *, size_t);
+
+/* -------------------- si468x-dsrv.c ----------------------- */
+
+int si468x_dsrv_init(struct si468x_core *);
+void si468x_dsrv_exit(struct si468x_core *);
+u8 *si468x_dsrv_reserve(struct si468x_core *,
+			const struct si468x_digital_service_data_status_report *);
+void si468x_dsrv_commit(struct si468x_core *);
+
+/* -------------------- si468x-follow.c ----------------------- */
+
+void si468x_follow_init(struct si468x_core *);
+void si468x_follow_exit(struct si468x_core *);
+void si468x_follow_degraded(struct si468x_core *);
+void si468x_follow_update(struct si468x_core *,
+			  const struct si468x_event_status_report *,
+			  const struct si468x_rsq_status_report *);
+int si468x_follow_show(struct si468x_core *, char *, size_t);
+
+/* -------------------- si468x-mot.c ----------------------- */
+
+int si468x_mot_init(struct si468x_core *);
+void si468x_mot_exit(struct si468x_core *);
+void si468x_mot_receive(struct si468x_core *,
+			const struct si468x_digital_service_data_status_report *);
+
+/* -------------------- si468x-rds.c ----------------------- */
+
+void si468x_rds_reset(struct si468x_core *);
+void si468x_rds_receive(struct si468x_core *,
+			const struct si468x_rds_status_report *);
+int si468x_rds_wait_pi(struct si468x_core *, unsigned int);
+void si468x_rds_flush(struct si468x_core *);
+
+/* -------------------- si468x-scan.c ----------------------- */
+
+void si468x_scan_init(struct si468x_core *);
+void si468x_scan_exit(struct si468x_core *);
+int si468x_scan_start(struct si468x_core *, bool);
+void si468x_scan_cancel(struct si468x_core *);
+int si468x_scan_show(struct si468x_core *, char *, size_t);
 
 #endif /* __SI468X_CMD_PRIV_H__ */
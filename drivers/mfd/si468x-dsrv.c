@@ -0,0 +1,358 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * drivers/mfd/si468x-dsrv.c -- DAB data service stream of si468x chips
+ *
+ * Copyright (C) 2020 HTL Steyr - Austria
+ * Copyright (C) 2020 Franz Parzer
+ *
+ * Author: Franz Parzer <rpi-receiver@htl-steyr.ac.at>
+ *
+ * Every GET_DIGITAL_SERVICE_DATA packet is stored with its header in a
+ * ring that is read through a character device, either with read() or
+ * by mapping the ring and advancing the tail of the control block. The
+ * payload is read from the chip straight into the ring. The core lock
+ * serializes the writer, a single reader is allowed. The ring is
+ * reference counted, an open file keeps it after the core was removed
+ * and only gets errors from then on.
+ */
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/kref.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
+#include <linux/poll.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+
+#include <linux/mfd/si468x-core.h>
+#include "si468x-cmd_priv.h"
+
+#define SI468X_DSRV_HDR_BYTES	PAGE_SIZE
+
+static u32 si468x_dsrv_used(struct si468x_core *core)
+{
+	struct si468x_dsrv_stream *dsrv = core->dsrv;
+	/* the tail is written by the reader, do not trust it */
+	u32 used = core->dsrv_head - smp_load_acquire(&dsrv->ring->tail);
+
+	return min(used, dsrv->size);
+}
+
+/**
+ * si468x_dsrv_reserve() - find room for a packet in the ring
+ * @core:   core device, locked
+ * @report: status of the packet to store
+ *
+ * Returns the payload area of the new record or NULL if nobody reads
+ * the ring or it is full. The record is published with
+ * si468x_dsrv_commit() once the payload was read, until then the ring
+ * is unchanged for the reader.
+ */
+u8 *si468x_dsrv_reserve(struct si468x_core *core,
+			const struct si468x_digital_service_data_status_report *report)
+{
+	struct si468x_dsrv_stream *dsrv = core->dsrv;
+	struct si468x_dsrv_record *rec;
+	u32 len = ALIGN(sizeof(*rec) + report->byte_count, SI468X_DSRV_ALIGN);
+	u32 pos = core->dsrv_head & (dsrv->size - 1);
+	u32 pad = 0;
+
+	if (!atomic_read(&dsrv->open))
+		return NULL;
+
+	if (pos + len > dsrv->size)
+		pad = dsrv->size - pos;
+	if (pad + len > dsrv->size - si468x_dsrv_used(core)) {
+		core->dsrv_drops++;
+		WRITE_ONCE(dsrv->ring->drops, core->dsrv_drops);
+		return NULL;
+	}
+
+	if (pad) {
+		rec = (struct si468x_dsrv_record *)(dsrv->data + pos);
+		memset(rec, 0, sizeof(*rec));
+		rec->len = pad;
+		rec->flags = SI468X_DSRV_PAD;
+		pos = 0;
+	}
+
+	rec = (struct si468x_dsrv_record *)(dsrv->data + pos);
+	rec->len = len;
+	rec->flags = 0;
+	rec->byte_count = report->byte_count;
+	rec->service_id = report->service_id;
+	rec->comp_id = report->comp_id;
+	rec->uatype = report->uatype;
+	rec->seg_num = report->seg_num;
+	rec->num_segs = report->num_segs;
+	rec->data_src = report->data_src;
+	rec->dscty = report->dscty;
+	rec->timestamp = ktime_get_ns();
+
+	/* skipped by si468x_dsrv_commit() together with the record */
+	core->dsrv_head += pad;
+
+	return (u8 *)(rec + 1);
+}
+
+/**
+ * si468x_dsrv_commit() - publish the record of si468x_dsrv_reserve()
+ * @core: core device, locked
+ */
+void si468x_dsrv_commit(struct si468x_core *core)
+{
+	struct si468x_dsrv_stream *dsrv = core->dsrv;
+	u32 pos = core->dsrv_head & (dsrv->size - 1);
+	struct si468x_dsrv_record *rec =
+		(struct si468x_dsrv_record *)(dsrv->data + pos);
+
+	core->dsrv_head += rec->len;
+	core->dsrv_records++;
+	/* the record has to be visible before the head */
+	smp_store_release(&dsrv->ring->head, core->dsrv_head);
+	wake_up_interruptible(&dsrv->wait);
+}
+
+static void si468x_dsrv_free(struct kref *kref)
+{
+	struct si468x_dsrv_stream *dsrv =
+		container_of(kref, struct si468x_dsrv_stream, kref);
+
+	vfree(dsrv->ring);
+	kfree(dsrv);
+}
+
+static int si468x_dsrv_open(struct inode *inode, struct file *file)
+{
+	/* misc_deregister() waits for open, the core is still there */
+	struct si468x_core *core = container_of(file->private_data,
+						struct si468x_core,
+						dsrv_misc);
+	struct si468x_dsrv_stream *dsrv = core->dsrv;
+
+	if (atomic_cmpxchg(&dsrv->open, 0, 1))
+		return -EBUSY;
+
+	/* start with an empty ring, the writer only runs with the lock */
+	si468x_core_lock(core);
+	core->dsrv_head = 0;
+	dsrv->ring->head = 0;
+	dsrv->ring->tail = 0;
+	dsrv->ring->drops = core->dsrv_drops;
+	si468x_core_unlock(core);
+
+	/* the file only uses the ring from now on */
+	kref_get(&dsrv->kref);
+	file->private_data = dsrv;
+
+	return stream_open(inode, file);
+}
+
+static int si468x_dsrv_release(struct inode *inode, struct file *file)
+{
+	struct si468x_dsrv_stream *dsrv = file->private_data;
+
+	atomic_set(&dsrv->open, 0);
+	kref_put(&dsrv->kref, si468x_dsrv_free);
+
+	return 0;
+}
+
+static bool si468x_dsrv_empty(struct si468x_dsrv_stream *dsrv)
+{
+	return smp_load_acquire(&dsrv->ring->head) ==
+	       READ_ONCE(dsrv->ring->tail);
+}
+
+static ssize_t si468x_dsrv_read(struct file *file, char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct si468x_dsrv_stream *dsrv = file->private_data;
+	struct si468x_dsrv_record *rec;
+	u32 head, tail, len;
+	ssize_t copied = 0;
+	int err = 0;
+
+	if (file->f_flags & O_NONBLOCK) {
+		if (READ_ONCE(dsrv->dead))
+			return -ENODEV;
+		if (si468x_dsrv_empty(dsrv))
+			return -EAGAIN;
+	} else {
+		err = wait_event_interruptible(dsrv->wait,
+					       READ_ONCE(dsrv->dead) ||
+					       !si468x_dsrv_empty(dsrv));
+		if (err < 0)
+			return err;
+		if (READ_ONCE(dsrv->dead))
+			return -ENODEV;
+	}
+
+	if (mutex_lock_interruptible(&dsrv->read_lock))
+		return -ERESTARTSYS;
+
+	head = smp_load_acquire(&dsrv->ring->head);
+	tail = READ_ONCE(dsrv->ring->tail);
+	if (head - tail > dsrv->size) {
+		err = -EIO;
+		goto unlock;
+	}
+
+	/* only whole records are copied */
+	while (tail != head) {
+		rec = (struct si468x_dsrv_record *)
+		      (dsrv->data + (tail & (dsrv->size - 1)));
+		len = READ_ONCE(rec->len);
+		/* the area is writable through mmap */
+		if (len < sizeof(*rec) || len > head - tail ||
+		    !IS_ALIGNED(len, SI468X_DSRV_ALIGN)) {
+			err = -EIO;
+			break;
+		}
+		if (!(rec->flags & SI468X_DSRV_PAD)) {
+			if (copied + len > count)
+				break;
+			if (copy_to_user(buf + copied, rec, len)) {
+				err = -EFAULT;
+				goto unlock;
+			}
+			copied += len;
+		}
+		tail += len;
+	}
+	smp_store_release(&dsrv->ring->tail, tail);
+	if (err < 0)
+		goto unlock;
+
+	if (!copied && tail != head)
+		err = -EINVAL;	/* buffer smaller than the next record */
+unlock:
+	mutex_unlock(&dsrv->read_lock);
+
+	return copied ? copied : err;
+}
+
+static __poll_t si468x_dsrv_poll(struct file *file,
+				 struct poll_table_struct *pts)
+{
+	struct si468x_dsrv_stream *dsrv = file->private_data;
+
+	poll_wait(file, &dsrv->wait, pts);
+
+	if (READ_ONCE(dsrv->dead))
+		return EPOLLERR | EPOLLHUP;
+	if (!si468x_dsrv_empty(dsrv))
+		return EPOLLIN | EPOLLRDNORM;
+
+	return 0;
+}
+
+static int si468x_dsrv_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct si468x_dsrv_stream *dsrv = file->private_data;
+
+	if (READ_ONCE(dsrv->dead))
+		return -ENODEV;
+	if (vma->vm_pgoff ||
+	    vma->vm_end - vma->vm_start != SI468X_DSRV_HDR_BYTES + dsrv->size)
+		return -EINVAL;
+
+	/* the mapping keeps the file and so the ring */
+	return remap_vmalloc_range(vma, dsrv->ring, 0);
+}
+
+static const struct file_operations si468x_dsrv_fops = {
+	.owner		= THIS_MODULE,
+	.open		= si468x_dsrv_open,
+	.release	= si468x_dsrv_release,
+	.read		= si468x_dsrv_read,
+	.poll		= si468x_dsrv_poll,
+	.mmap		= si468x_dsrv_mmap,
+	.llseek		= no_llseek,
+};
+
+/**
+ * si468x_dsrv_init() - allocate the ring and register the device
+ * @core: core device
+ *
+ * The size of the ring is taken from the DT property data-ring-size.
+ */
+int si468x_dsrv_init(struct si468x_core *core)
+{
+	struct si468x_dsrv_stream *dsrv;
+	u32 size;
+	int err;
+
+	if (of_property_read_u32(core->dev->of_node, "data-ring-size",
+				 &size))
+		size = SI468X_DSRV_RING_DEFAULT;
+	size = clamp_t(u32, size, SI468X_DSRV_RING_MIN, SI468X_DSRV_RING_MAX);
+
+	core->dsrv_scratch = devm_kmalloc(core->dev,
+					  SI468X_SERVICE_DATA_MAX_LENGTH,
+					  GFP_KERNEL);
+	if (!core->dsrv_scratch)
+		return -ENOMEM;
+
+	/* not devm, an open file may keep it after remove */
+	dsrv = kzalloc(sizeof(*dsrv), GFP_KERNEL);
+	if (!dsrv)
+		return -ENOMEM;
+	kref_init(&dsrv->kref);
+	atomic_set(&dsrv->open, 0);
+	init_waitqueue_head(&dsrv->wait);
+	mutex_init(&dsrv->read_lock);
+	dsrv->size = roundup_pow_of_two(size);
+
+	dsrv->ring = vmalloc_user(SI468X_DSRV_HDR_BYTES + dsrv->size);
+	if (!dsrv->ring) {
+		err = -ENOMEM;
+		goto put;
+	}
+	dsrv->data = (u8 *)dsrv->ring + SI468X_DSRV_HDR_BYTES;
+	dsrv->ring->size = dsrv->size;
+	dsrv->ring->data_offset = SI468X_DSRV_HDR_BYTES;
+	core->dsrv = dsrv;
+
+	core->dsrv_misc.minor = MISC_DYNAMIC_MINOR;
+	core->dsrv_misc.name = devm_kasprintf(core->dev, GFP_KERNEL,
+					      "si468x-data-%s",
+					      dev_name(core->dev));
+	core->dsrv_misc.fops = &si468x_dsrv_fops;
+	core->dsrv_misc.parent = core->dev;
+	if (!core->dsrv_misc.name) {
+		err = -ENOMEM;
+		goto put;
+	}
+
+	err = misc_register(&core->dsrv_misc);
+	if (err < 0)
+		goto put;
+
+	return 0;
+
+put:
+	core->dsrv = NULL;
+	kref_put(&dsrv->kref, si468x_dsrv_free);
+
+	return err;
+}
+
+/**
+ * si468x_dsrv_exit() - unregister the device and drop the ring
+ * @core: core device
+ *
+ * A file that is still open keeps the ring, its readers are woken up
+ * and fail with -ENODEV. The ring is freed with the last close.
+ */
+void si468x_dsrv_exit(struct si468x_core *core)
+{
+	struct si468x_dsrv_stream *dsrv = core->dsrv;
+
+	misc_deregister(&core->dsrv_misc);
+	WRITE_ONCE(dsrv->dead, true);
+	wake_up_interruptible_all(&dsrv->wait);
+	core->dsrv = NULL;
+	kref_put(&dsrv->kref, si468x_dsrv_free);
+}
@@ -0,0 +1,416 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * drivers/mfd/si468x-follow.c -- DAB service following of si468x chips
+ *
+ * Copyright (C) 2020 HTL Steyr - Austria
+ * Copyright (C) 2020 Franz Parzer
+ *
+ * Author: Franz Parzer <rpi-receiver@htl-steyr.ac.at>
+ *
+ * While the reception is good, the hard linked services (FIG 0/6) of
+ * the running service and the frequency information (FIG 0/21) of the
+ * ensemble are cached whenever the chip reports an update. When the
+ * DACQ interrupt reports lost acquisition or an RSSI below the
+ * threshold and the reception is still degraded SI468X_FOLLOW_HOLDOFF
+ * ms later, the strongest linked service in another known ensemble is
+ * started. If none works, the radio cell is asked to switch to an FM
+ * frequency carrying a linked PI code. Everything runs with the core
+ * lock held.
+ */
+#include <linux/module.h>
+#include <linux/slab.h>
+
+#include <linux/mfd/si468x-core.h>
+#include "si468x-cmd_priv.h"
+
+#include <asm/unaligned.h>
+
+#define SI468X_LINK_ACTIVE	BIT(0)
+#define SI468X_LINK_HARD	BIT(1)
+#define SI468X_LINK_TYPE_DAB	0
+#define SI468X_LINK_TYPE_RDS	1
+#define SI468X_FI_ENTRY_BYTES	12
+
+/* the service id as broadcast, the channel database splits it */
+static u32 si468x_follow_sid(const struct si468x_dab_channel *ch)
+{
+	return ch->country_id << 12 | ch->service_id;
+}
+
+static bool si468x_follow_is_linked(struct si468x_follow *follow, u32 sid)
+{
+	int i;
+
+	if (sid == follow->service_id)
+		return true;
+	for (i = 0; i < follow->nr_sids; i++)
+		if (follow->sids[i] == sid)
+			return true;
+
+	return false;
+}
+
+static bool si468x_follow_is_linked_pi(struct si468x_follow *follow, u32 pi)
+{
+	int i;
+
+	/* FM simulcasts usually carry the SId of the DAB service as PI */
+	if (pi == follow->service_id)
+		return true;
+	for (i = 0; i < follow->nr_pis; i++)
+		if (follow->pis[i] == pi)
+			return true;
+
+	return false;
+}
+
+static struct si468x_dab_channel *si468x_follow_current(struct si468x_core *core)
+{
+	struct si468x_dab_channel *ptr;
+
+	list_for_each_entry(ptr, &core->dab_channels.list, list)
+		if (ptr->is_started)
+			return ptr;
+
+	return NULL;
+}
+
+static void si468x_follow_parse_links(struct si468x_follow *follow,
+				      const u8 *buf, int len)
+{
+	const u8 *p = buf + 2, *end = buf + len;
+	int nr_sets, n, type, i;
+
+	if (len < 2)
+		return;
+
+	for (nr_sets = buf[0]; nr_sets && p + 4 <= end; nr_sets--) {
+		type = p[3] >> 4;
+		n = p[3] & 0x0f;
+		if (p + 4 + 4 * n > end)
+			break;
+
+		/* soft links carry related, not the same content */
+		if ((p[2] & SI468X_LINK_ACTIVE) && (p[2] & SI468X_LINK_HARD)) {
+			for (i = 0; i < n; i++) {
+				u32 id = get_unaligned_le32(p + 4 + 4 * i);
+
+				if (type == SI468X_LINK_TYPE_DAB &&
+				    follow->nr_sids < SI468X_FOLLOW_MAX_IDS)
+					follow->sids[follow->nr_sids++] = id;
+				else if (type == SI468X_LINK_TYPE_RDS &&
+					 follow->nr_pis < SI468X_FOLLOW_MAX_IDS)
+					follow->pis[follow->nr_pis++] = id;
+			}
+		}
+		p += 4 + 4 * n;
+	}
+}
+
+static void si468x_follow_parse_freqs(struct si468x_follow *follow,
+				      const u8 *buf, int len)
+{
+	struct si468x_follow_freq *fi;
+
+	follow->nr_freqs = 0;
+	for (; len >= SI468X_FI_ENTRY_BYTES &&
+	       follow->nr_freqs < SI468X_FOLLOW_MAX_FREQS;
+	     buf += SI468X_FI_ENTRY_BYTES, len -= SI468X_FI_ENTRY_BYTES) {
+		fi = &follow->freqs[follow->nr_freqs++];
+		fi->id = get_unaligned_le32(buf);
+		fi->freq = get_unaligned_le32(buf + 4);
+		fi->rnm = buf[8] & 0x0f;
+	}
+}
+
+/**
+ * si468x_follow_update() - cache linking sets and frequency information
+ * @core:   core device, locked
+ * @report: event status that announced the update
+ * @rsq:    reception of the tuned ensemble
+ *
+ * Only runs while the reception is good, the cache is what service
+ * following relies on once it is not.
+ */
+void si468x_follow_update(struct si468x_core *core,
+			  const struct si468x_event_status_report *report,
+			  const struct si468x_rsq_status_report *rsq)
+{
+	struct si468x_follow *follow = &core->follow;
+	struct si468x_dab_channel *cur;
+	u8 *buf;
+	int len;
+
+	if (!follow->enabled || !rsq->valid ||
+	    rsq->fic_quality < SI468X_FOLLOW_MIN_FIC_QUALITY)
+		return;
+
+	cur = si468x_follow_current(core);
+	if (!cur || !cur->is_audio_service)
+		return;
+
+	/* the sets of another service are useless */
+	if (follow->service_id != si468x_follow_sid(cur)) {
+		follow->service_id = si468x_follow_sid(cur);
+		follow->nr_sids = 0;
+		follow->nr_pis = 0;
+		follow->nr_freqs = 0;
+	} else if (!report->servlink && !report->freq_info) {
+		return;
+	}
+
+	buf = kmalloc(SI468X_FOLLOW_MAX_REPLY, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	len = si468x_core_cmd_dab_get_service_linking_info(core,
+						follow->service_id,
+						buf, SI468X_FOLLOW_MAX_REPLY);
+	if (!(len < 0)) {
+		follow->nr_sids = 0;
+		follow->nr_pis = 0;
+		si468x_follow_parse_links(follow, buf, len);
+	}
+
+	len = si468x_core_cmd_dab_get_freq_info(core, buf,
+						SI468X_FOLLOW_MAX_REPLY);
+	if (!(len < 0))
+		si468x_follow_parse_freqs(follow, buf, len);
+
+	kfree(buf);
+}
+
+/**
+ * si468x_follow_degraded() - the chip signalled a DACQ interrupt
+ * @core: core device
+ *
+ * Called by the interrupt dispatcher, the reception is checked again
+ * after SI468X_FOLLOW_HOLDOFF ms, so short fades do not cause a
+ * switch.
+ */
+void si468x_follow_degraded(struct si468x_core *core)
+{
+	if (READ_ONCE(core->follow.enabled))
+		mod_delayed_work(system_wq, &core->follow.work,
+				 msecs_to_jiffies(SI468X_FOLLOW_HOLDOFF));
+}
+
+static bool si468x_follow_reception_ok(struct si468x_core *core, bool ack)
+{
+	struct si468x_rsq_status_report rsq;
+	struct si468x_rsq_status_args args = {
+		.digradack	= ack,
+	};
+
+	if (si468x_core_cmd_dab_rsq_status(core, &args, &rsq) < 0)
+		return false;
+
+	return rsq.valid && rsq.acq && rsq.rssi >= core->follow.rssi_low &&
+	       rsq.fic_quality >= SI468X_FOLLOW_MIN_FIC_QUALITY;
+}
+
+/* strongest linked service in an ensemble that was not tried yet */
+static struct si468x_dab_channel *
+si468x_follow_best_dab(struct si468x_core *core,
+		       const struct si468x_dab_channel *cur,
+		       const u32 *tried, int nr_tried)
+{
+	struct si468x_dab_channel *ptr, *best = NULL;
+	int i;
+
+	list_for_each_entry(ptr, &core->dab_channels.list, list) {
+		if (!ptr->is_audio_service ||
+		    ptr->component_info.is_secondary ||
+		    ptr->frequency == cur->frequency ||
+		    !si468x_follow_is_linked(&core->follow,
+					     si468x_follow_sid(ptr)))
+			continue;
+		for (i = 0; i < nr_tried; i++)
+			if (tried[i] == ptr->frequency)
+				break;
+		if (i < nr_tried)
+			continue;
+		if (!best || ptr->signal_strength > best->signal_strength)
+			best = ptr;
+	}
+
+	return best;
+}
+
+static int si468x_follow_to_dab(struct si468x_core *core,
+				struct si468x_dab_channel *cur)
+{
+	struct si468x_dab_channel *next;
+	u32 tried[SI468X_FOLLOW_MAX_TRIES];
+	int i, err;
+
+	for (i = 0; i < SI468X_FOLLOW_MAX_TRIES; i++) {
+		next = si468x_follow_best_dab(core, cur, tried, i);
+		if (!next)
+			break;
+		tried[i] = next->frequency;
+
+		/* tuning stops the running service */
+		cur->is_started = false;
+		err = si468x_core_cmd_dab_start_service(core, next);
+		if (!(err < 0) && si468x_follow_reception_ok(core, false)) {
+			dev_info(core->dev,
+				 "Following service 0x%04x to %u kHz\n",
+				 si468x_follow_sid(next), next->frequency);
+			core->follow.dab_switches++;
+			return 0;
+		}
+		next->is_started = false;
+	}
+
+	return -ENOENT;
+}
+
+static int si468x_follow_to_fm(struct si468x_core *core)
+{
+	struct si468x_follow *follow = &core->follow;
+	struct si468x_follow_freq *fi;
+	int i, ret;
+
+	for (i = 0; i < follow->nr_freqs; i++) {
+		fi = &follow->freqs[i];
+		if (fi->rnm != SI468X_FI_RNM_FM_RDS ||
+		    !si468x_follow_is_linked_pi(follow, fi->id))
+			continue;
+
+		ret = blocking_notifier_call_chain(&core->notifier,
+						   SI468X_EVENT_FOLLOW_FM, fi);
+		/* no cell took care of it */
+		if (ret == NOTIFY_DONE)
+			return -ENODEV;
+		if (notifier_to_errno(ret) < 0)
+			continue;
+
+		dev_info(core->dev,
+			 "Following service 0x%04x to FM %u kHz (PI 0x%04x)\n",
+			 follow->service_id, fi->freq, fi->id);
+		follow->fm_switches++;
+		return 0;
+	}
+
+	return -ENOENT;
+}
+
+static void si468x_follow_work(struct work_struct *work)
+{
+	struct si468x_core *core = container_of(to_delayed_work(work),
+						struct si468x_core,
+						follow.work);
+	struct si468x_dab_channel *cur;
+
+	si468x_core_lock(core);
+	if (!atomic_read(&core->is_alive) || !core->follow.enabled ||
+	    !si468x_core_is_in_dab_receiver_mode(core) ||
+	    atomic_read(&core->dab_full_scan))
+		goto unlock;
+
+	if (si468x_follow_reception_ok(core, true))
+		goto unlock;
+
+	cur = si468x_follow_current(core);
+	if (!cur || si468x_follow_sid(cur) != core->follow.service_id)
+		goto unlock;
+
+	if (si468x_follow_to_dab(core, cur) < 0 &&
+	    si468x_follow_to_fm(core) < 0) {
+		/* keep the service, it may come back */
+		if (!cur->is_started)
+			si468x_core_cmd_dab_start_service(core, cur);
+		core->follow.failures++;
+	}
+unlock:
+	si468x_core_unlock(core);
+}
+
+/**
+ * si468x_core_set_service_following() - configure service following
+ * @core:     core device, locked
+ * @enable:   switch to linked services when the reception degrades
+ * @rssi_low: RSSI in dBuV below which the reception is degraded
+ *
+ * Enables the interrupts service following depends on, the DAB
+ * properties are written to the chip with the next power-up if it is
+ * not running in DAB mode.
+ */
+int si468x_core_set_service_following(struct si468x_core *core,
+				      bool enable, s8 rssi_low)
+{
+	u16 digrad = SI468X_PROP_RSSILINTEN | SI468X_PROP_ACQINTEN;
+	u16 event = SI468X_PROP_SERVLINK_INTEN_MASK |
+		    SI468X_PROP_FREQINFO_INTEN_MASK;
+	int err;
+
+	if (!core->si468x_device_info->has_dab)
+		return enable ? -EINVAL : 0;
+
+	err = regmap_write(core->regmap_dab,
+			   SI468X_PROP_DAB_DIGRAD_RSSI_LOW_THRESHOLD,
+			   (u8)rssi_low);
+	if (err < 0)
+		return err;
+	err = regmap_update_bits(core->regmap_dab,
+				 SI468X_PROP_DAB_DIGRAD_INTERRUPT_SOURCE,
+				 digrad, enable ? digrad : 0);
+	if (err < 0)
+		return err;
+	err = regmap_update_bits(core->regmap_dab,
+				 SI468X_PROP_DAB_EVENT_INTERRUPT_SOURCE,
+				 event, enable ? event : 0);
+	if (err < 0)
+		return err;
+
+	core->follow.rssi_low = rssi_low;
+	WRITE_ONCE(core->follow.enabled, enable);
+	if (!enable)
+		cancel_delayed_work(&core->follow.work);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(si468x_core_set_service_following);
+
+/**
+ * si468x_follow_show() - describe the state for debugfs
+ * @core: core device, locked
+ * @buf:  output buffer
+ * @size: size of @buf
+ */
+int si468x_follow_show(struct si468x_core *core, char *buf, size_t size)
+{
+	struct si468x_follow *follow = &core->follow;
+	int i, len;
+
+	len = scnprintf(buf, size,
+			"enabled %d rssi_low %d service 0x%04x\n"
+			"dab_switches %u fm_switches %u failures %u\n",
+			follow->enabled, follow->rssi_low, follow->service_id,
+			follow->dab_switches, follow->fm_switches,
+			follow->failures);
+	for (i = 0; i < follow->nr_sids; i++)
+		len += scnprintf(buf + len, size - len, "dab 0x%04x\n",
+				 follow->sids[i]);
+	for (i = 0; i < follow->nr_pis; i++)
+		len += scnprintf(buf + len, size - len, "pi 0x%04x\n",
+				 follow->pis[i]);
+	for (i = 0; i < follow->nr_freqs; i++)
+		len += scnprintf(buf + len, size - len, "freq %u kHz id 0x%04x rnm %u\n",
+				 follow->freqs[i].freq, follow->freqs[i].id,
+				 follow->freqs[i].rnm);
+
+	return len;
+}
+
+void si468x_follow_init(struct si468x_core *core)
+{
+	core->follow.rssi_low = SI468X_FOLLOW_RSSI_LOW_DEFAULT;
+	INIT_DELAYED_WORK(&core->follow.work, si468x_follow_work);
+}
+
+void si468x_follow_exit(struct si468x_core *core)
+{
+	cancel_delayed_work_sync(&core->follow.work);
+}
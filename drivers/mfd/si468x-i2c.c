@@ -26,17 +26,16 @@
 static int si468x_smbus_write(struct si468x_core *core,
 			      char *buf, int count)
 {
-	static int io_errors_count;
 	struct i2c_client *client = to_i2c_client(core->dev);
 	int err;
 
 	err = i2c_master_send(client, buf, count);
 
 	if (err < 0) {
-		if (io_errors_count++ > SI468X_MAX_IO_ERRORS)
+		if (core->io_errors_count++ > SI468X_MAX_IO_ERRORS)
 			si468x_core_pronounce_dead(core);
 	} else {
-		io_errors_count = 0;
+		core->io_errors_count = 0;
 	}
 
 	return err;
@@ -45,26 +44,65 @@ static int si468x_smbus_write(struct si468x_core *core,
 static int si468x_smbus_read(struct si468x_core *core,
 			     char *buf, int count)
 {
-	static int io_errors_count;
 	struct i2c_client *client = to_i2c_client(core->dev);
 	int err;
 
 	err = i2c_master_recv(client, buf, count);
 
 	if (err < 0) {
-		if (io_errors_count++ > SI468X_MAX_IO_ERRORS)
+		if (core->io_errors_count++ > SI468X_MAX_IO_ERRORS)
 			si468x_core_pronounce_dead(core);
 	} else {
-		io_errors_count = 0;
+		core->io_errors_count = 0;
 	}
 
 	return err;
 }
 
+static int si468x_i2c_write_sg(struct si468x_core *core,
+			       const char *hdr, int hdr_count,
+			       const char *buf, int count)
+{
+	struct i2c_client *client = to_i2c_client(core->dev);
+	struct i2c_msg msgs[] = {
+		{
+			.addr	= client->addr,
+			.flags	= 0,
+			.len	= hdr_count,
+			.buf	= (u8 *)hdr,
+		},
+		{
+			.addr	= client->addr,
+			.flags	= I2C_M_NOSTART,
+			.len	= count,
+			.buf	= (u8 *)buf,
+		},
+	};
+	int err;
+
+	/* without NOSTART the core copies the data into one buffer */
+	if (!i2c_check_functionality(client->adapter, I2C_FUNC_NOSTART))
+		return -EOPNOTSUPP;
+
+	err = i2c_transfer(client->adapter, msgs, ARRAY_SIZE(msgs));
+	if (err >= 0 && err != ARRAY_SIZE(msgs))
+		err = -EIO;
+
+	if (err < 0) {
+		if (core->io_errors_count++ > SI468X_MAX_IO_ERRORS)
+			si468x_core_pronounce_dead(core);
+	} else {
+		core->io_errors_count = 0;
+	}
+
+	return (err < 0) ? err : hdr_count + count;
+}
+
 const struct si468x_bus_ops si468x_i2c_bus_ops = {
 	.bustype	= BUS_I2C,
 	.write		= si468x_smbus_write,
 	.read		= si468x_smbus_read,
+	.write_sg	= si468x_i2c_write_sg,
 };
 
 static int si468x_i2c_probe(struct i2c_client *client,
@@ -0,0 +1,384 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * drivers/mfd/si468x-mot.c -- MOT slideshow reassembly of si468x chips
+ *
+ * Copyright (C) 2020 HTL Steyr - Austria
+ * Copyright (C) 2020 Franz Parzer
+ *
+ * Author: Franz Parzer <rpi-receiver@htl-steyr.ac.at>
+ *
+ * Slideshow objects (ETSI TS 101 499) arrive as MSC data groups
+ * (ETSI EN 300 401, 5.3.3) carrying the MOT header and the segments of
+ * the body. Bodies are collected in SI468X_MOT_SLOTS preallocated
+ * buffers, one per transport id. A complete object is published by
+ * replacing the previous image, readers of core->mot_image only need
+ * rcu_read_lock(). The slot continues with a spare buffer and the old
+ * image is freed after a grace period, so publishing never waits for
+ * the readers. Everything else runs with the core lock held.
+ */
+#include <linux/module.h>
+#include <linux/bitmap.h>
+#include <linux/crc-itu-t.h>
+#include <linux/jiffies.h>
+#include <linux/slab.h>
+
+#include <linux/mfd/si468x-core.h>
+#include "si468x-cmd_priv.h"
+
+#include <asm/unaligned.h>
+
+enum si468x_mot_dg_type {
+	SI468X_MOT_DG_HEADER	= 3,
+	SI468X_MOT_DG_BODY	= 4,
+};
+
+/* MOT header core, ETSI EN 301 234 6.1 */
+#define SI468X_MOT_HEADER_CORE	7
+/* content type of images */
+#define SI468X_MOT_CONTENT_IMAGE	2
+
+struct si468x_mot_dg {
+	u8   type;
+	bool last;
+	u16  seg_num;
+	u16  transport_id;
+	const u8 *seg;
+	u16  seg_len;
+};
+
+static struct si468x_mot_object *si468x_mot_alloc(void)
+{
+	return kvzalloc(sizeof(struct si468x_mot_object) +
+			SI468X_MOT_MAX_BODY, GFP_KERNEL);
+}
+
+static void si468x_mot_free_rcu(struct rcu_head *head)
+{
+	kvfree(container_of(head, struct si468x_mot_object, rcu));
+}
+
+/*
+ * Parse an MSC data group up to the segment data. Groups without a
+ * transport id or segment field are of no use for MOT.
+ */
+static int si468x_mot_parse_dg(const u8 *buf, u32 len,
+			       struct si468x_mot_dg *dg)
+{
+	const u8 *p = buf, *end = buf + len;
+	bool ext, crc, seg, ua;
+	u8 li;
+
+	if (len < 2)
+		return -EINVAL;
+
+	ext = p[0] & 0x80;
+	crc = p[0] & 0x40;
+	seg = p[0] & 0x20;
+	ua  = p[0] & 0x10;
+	dg->type = p[0] & 0x0f;
+	p += 2;
+
+	if (crc) {
+		if (len < 4)
+			return -EINVAL;
+		end -= 2;
+		if ((crc_itu_t(0xffff, buf, end - buf) ^ 0xffff) !=
+		    get_unaligned_be16(end))
+			return -EBADMSG;
+	}
+
+	if (ext)
+		p += 2;
+	if (!seg || !ua || p + 3 > end)
+		return -EINVAL;
+
+	dg->last = p[0] & 0x80;
+	dg->seg_num = get_unaligned_be16(p) & 0x7fff;
+	p += 2;
+
+	/* user access field, the transport id comes first */
+	li = p[0] & 0x0f;
+	if (!(p[0] & 0x10) || li < 2 || p + 1 + li > end)
+		return -EINVAL;
+	dg->transport_id = get_unaligned_be16(p + 1);
+	p += 1 + li;
+
+	/* segmentation header, the repetition count is ignored */
+	if (p + 2 > end)
+		return -EINVAL;
+	dg->seg_len = get_unaligned_be16(p) & 0x1fff;
+	p += 2;
+	if (p + dg->seg_len > end)
+		return -EINVAL;
+	dg->seg = p;
+
+	return 0;
+}
+
+static void si468x_mot_reset_slot(struct si468x_mot_slot *slot)
+{
+	slot->used = false;
+	slot->header_done = false;
+	slot->body_size = 0;
+	slot->seg_size = 0;
+	slot->last_seg = -1;
+	bitmap_zero(slot->segs, SI468X_MOT_MAX_SEGS);
+}
+
+/*
+ * Return the slot of the object, taking a free or stale slot for a new
+ * one. If all are busy, the object that waited longest for a segment
+ * is evicted.
+ */
+static struct si468x_mot_slot *si468x_mot_get_slot(struct si468x_core *core,
+						   u32 service_id,
+						   u16 transport_id)
+{
+	struct si468x_mot_slot *slot, *victim = NULL;
+	int i;
+
+	for (i = 0; i < SI468X_MOT_SLOTS; i++) {
+		slot = &core->mot_slots[i];
+		if (slot->used && slot->service_id == service_id &&
+		    slot->transport_id == transport_id)
+			return slot;
+	}
+
+	for (i = 0; i < SI468X_MOT_SLOTS; i++) {
+		slot = &core->mot_slots[i];
+		if (slot->used &&
+		    time_after(jiffies, slot->updated +
+			       msecs_to_jiffies(SI468X_MOT_STALE_TIME)))
+			si468x_mot_reset_slot(slot);
+		if (!slot->used) {
+			victim = slot;
+			break;
+		}
+		if (!victim || time_before(slot->updated, victim->updated))
+			victim = slot;
+	}
+
+	if (victim->used)
+		core->mot_evictions++;
+	si468x_mot_reset_slot(victim);
+	victim->used = true;
+	victim->service_id = service_id;
+	victim->transport_id = transport_id;
+
+	return victim;
+}
+
+static void si468x_mot_header(struct si468x_mot_slot *slot,
+			      const struct si468x_mot_dg *dg)
+{
+	const u8 *h = dg->seg;
+
+	/* only headers in a single segment, slideshow headers are short */
+	if (dg->seg_num || !dg->last || dg->seg_len < SI468X_MOT_HEADER_CORE)
+		return;
+
+	slot->body_size = get_unaligned_be32(h) >> 4;
+	slot->obj->content_type = (h[5] >> 1) & 0x3f;
+	slot->obj->content_subtype = ((h[5] & 0x01) << 8) | h[6];
+	slot->header_done = true;
+}
+
+static void si468x_mot_body(struct si468x_mot_slot *slot,
+			    const struct si468x_mot_dg *dg)
+{
+	u32 pos;
+
+	if (dg->seg_num >= SI468X_MOT_MAX_SEGS)
+		return;
+
+	if (!dg->last) {
+		/* all segments but the last have the same size */
+		if (!dg->seg_len ||
+		    (slot->seg_size && slot->seg_size != dg->seg_len))
+			return;
+		slot->seg_size = dg->seg_len;
+	} else {
+		if (!slot->seg_size && dg->seg_num)
+			return;	/* placed once it is repeated */
+		slot->last_seg = dg->seg_num;
+	}
+
+	pos = dg->seg_num * slot->seg_size;
+	if (pos + dg->seg_len > SI468X_MOT_MAX_BODY)
+		return;
+
+	memcpy(slot->obj->data + pos, dg->seg, dg->seg_len);
+	set_bit(dg->seg_num, slot->segs);
+	if (dg->last)
+		slot->obj->size = pos + dg->seg_len;
+}
+
+static bool si468x_mot_complete(struct si468x_mot_slot *slot)
+{
+	return slot->header_done && slot->last_seg >= 0 &&
+	       bitmap_full(slot->segs, slot->last_seg + 1) &&
+	       slot->obj->size == slot->body_size;
+}
+
+static void si468x_mot_publish(struct si468x_core *core,
+			       struct si468x_mot_slot *slot)
+{
+	struct si468x_mot_object *new = slot->obj, *old;
+
+	/* refill the spare the last publish used */
+	if (!core->mot_spare)
+		core->mot_spare = si468x_mot_alloc();
+	if (!core->mot_spare) {
+		core->mot_errors++;
+		si468x_mot_reset_slot(slot);
+		return;
+	}
+
+	new->seq = ++core->mot_seq;
+	new->service_id = slot->service_id;
+	new->transport_id = slot->transport_id;
+
+	old = rcu_dereference_protected(core->mot_image,
+					lockdep_is_held(&core->cmd_lock));
+	rcu_assign_pointer(core->mot_image, new);
+	slot->obj = core->mot_spare;
+	core->mot_spare = NULL;
+	si468x_mot_reset_slot(slot);
+	/* sysfs readers may still copy the old image */
+	call_rcu(&old->rcu, si468x_mot_free_rcu);
+
+	sysfs_notify(&core->dev->kobj, NULL, "si468x_slideshow");
+	sysfs_notify(&core->dev->kobj, NULL, "si468x_slideshow_info");
+	blocking_notifier_call_chain(&core->notifier, SI468X_EVENT_MOT_IMAGE,
+				     new);
+}
+
+/*
+ * The chip splits data groups that do not fit into one packet, the
+ * pieces are numbered from 0.
+ */
+static const u8 *si468x_mot_join(struct si468x_core *core,
+				 const struct si468x_digital_service_data_status_report *report,
+				 u32 *len)
+{
+	if (report->num_segs <= 1) {
+		*len = report->byte_count;
+		return report->payload;
+	}
+
+	if (report->seg_num == 0)
+		core->mot_dg_len = 0;
+	if (core->mot_dg_len + report->byte_count > SI468X_MOT_MAX_DG) {
+		core->mot_dg_len = 0;
+		return NULL;
+	}
+	memcpy(core->mot_dg + core->mot_dg_len, report->payload,
+	       report->byte_count);
+	core->mot_dg_len += report->byte_count;
+	if (report->seg_num + 1 != report->num_segs)
+		return NULL;
+
+	*len = core->mot_dg_len;
+	core->mot_dg_len = 0;
+
+	return core->mot_dg;
+}
+
+/**
+ * si468x_mot_receive() - feed a slideshow packet into the reassembly
+ * @core:   core device, locked
+ * @report: packet read with GET_DIGITAL_SERVICE_DATA
+ */
+void si468x_mot_receive(struct si468x_core *core,
+			const struct si468x_digital_service_data_status_report *report)
+{
+	struct si468x_mot_slot *slot;
+	struct si468x_mot_dg dg;
+	const u8 *buf;
+	u32 len;
+
+	buf = si468x_mot_join(core, report, &len);
+	if (!buf)
+		return;
+
+	if (si468x_mot_parse_dg(buf, len, &dg) < 0) {
+		core->mot_errors++;
+		return;
+	}
+	if (dg.type != SI468X_MOT_DG_HEADER && dg.type != SI468X_MOT_DG_BODY)
+		return;
+
+	slot = si468x_mot_get_slot(core, report->service_id, dg.transport_id);
+	slot->updated = jiffies;
+
+	if (dg.type == SI468X_MOT_DG_HEADER)
+		si468x_mot_header(slot, &dg);
+	else
+		si468x_mot_body(slot, &dg);
+
+	if (!si468x_mot_complete(slot))
+		return;
+
+	if (slot->obj->content_type == SI468X_MOT_CONTENT_IMAGE)
+		si468x_mot_publish(core, slot);
+	else
+		si468x_mot_reset_slot(slot);
+}
+
+/**
+ * si468x_mot_init() - allocate the reassembly buffers
+ * @core: core device
+ */
+int si468x_mot_init(struct si468x_core *core)
+{
+	struct si468x_mot_object *obj;
+	int i;
+
+	core->mot_dg = devm_kmalloc(core->dev, SI468X_MOT_MAX_DG, GFP_KERNEL);
+	core->mot_slots = devm_kcalloc(core->dev, SI468X_MOT_SLOTS,
+				       sizeof(*core->mot_slots), GFP_KERNEL);
+	if (!core->mot_dg || !core->mot_slots)
+		return -ENOMEM;
+
+	for (i = 0; i < SI468X_MOT_SLOTS; i++) {
+		core->mot_slots[i].obj = si468x_mot_alloc();
+		if (!core->mot_slots[i].obj)
+			goto free_objs;
+		si468x_mot_reset_slot(&core->mot_slots[i]);
+	}
+
+	/* an empty image, so readers never see NULL */
+	obj = si468x_mot_alloc();
+	if (!obj)
+		goto free_objs;
+	RCU_INIT_POINTER(core->mot_image, obj);
+
+	core->mot_spare = si468x_mot_alloc();
+	if (!core->mot_spare) {
+		kvfree(obj);
+		goto free_objs;
+	}
+
+	return 0;
+
+free_objs:
+	while (i--)
+		kvfree(core->mot_slots[i].obj);
+
+	return -ENOMEM;
+}
+
+/**
+ * si468x_mot_exit() - free the reassembly buffers
+ * @core: core device without readers left
+ */
+void si468x_mot_exit(struct si468x_core *core)
+{
+	int i;
+
+	for (i = 0; i < SI468X_MOT_SLOTS; i++)
+		kvfree(core->mot_slots[i].obj);
+	kvfree(core->mot_spare);
+	/* replaced images are freed by call_rcu(), see the module exit */
+	kvfree(rcu_dereference_protected(core->mot_image, true));
+}
@@ -13,6 +13,7 @@
  * Author: Andrey Smirnov <andrew.smirnov@gmail.com>
  */
 #include <linux/module.h>
+#include <linux/ktime.h>
 
 #include <linux/mfd/si468x-core.h>
 
@@ -474,6 +475,9 @@ static int si468x_core_regmap_write(void *context, unsigned int reg,
 	if (err < 0)
 		return err;
 
+	if (core->prop_sync_active)
+		core->prop_sync_count++;
+
 	return 0;
 }
 
@@ -629,3 +633,137 @@ int devm_regmap_init_si468x(struct si468x_core *core)
 	return 0;
 }
 EXPORT_SYMBOL_GPL(devm_regmap_init_si468x);
+
+/**
+ * si468x_core_sync_properties() - write the property cache to the chip
+ * @core: Core device structure, locked by the caller
+ * @map:  regmap of the properties to write
+ *
+ * Used after every power up. Properties that differ from the chip
+ * defaults are written back to back with polled CTS, see
+ * si468x_core_stream_property(). Number and duration of the writes
+ * are kept in @core->prop_sync_count and @core->prop_sync_usecs.
+ *
+ * Function returns 0 on succsess and negative error code on
+ * failure
+ */
+int si468x_core_sync_properties(struct si468x_core *core, struct regmap *map)
+{
+	ktime_t start;
+	int err;
+
+	regcache_mark_dirty(map);
+	regcache_cache_only(map, false);
+
+	core->prop_sync_count = 0;
+	core->prop_sync_active = true;
+	start = ktime_get();
+	err = regcache_sync(map);
+	core->prop_sync_usecs = ktime_us_delta(ktime_get(), start);
+	core->prop_sync_active = false;
+
+	dev_dbg(core->dev, "Synced %u properties in %lld us (%d)\n",
+		core->prop_sync_count, core->prop_sync_usecs, err);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(si468x_core_sync_properties);
+
+static int si468x_core_bench_table(struct si468x_core *core,
+				   const char *name,
+				   const struct reg_default *defaults,
+				   int num, char *buf, size_t size)
+{
+	ktime_t start;
+	s64 usecs;
+	int err = 0;
+	int i;
+
+	core->prop_sync_active = true;
+	start = ktime_get();
+	for (i = 0; i < num && err >= 0; i++)
+		err = si468x_core_cmd_set_property(core, defaults[i].reg,
+						   defaults[i].def);
+	usecs = ktime_us_delta(ktime_get(), start);
+	core->prop_sync_active = false;
+
+	if (err < 0)
+		return err;
+
+	return scnprintf(buf, size, "%s: %d properties in %lld us\n",
+			 name, num, usecs);
+}
+
+/**
+ * si468x_core_bench_properties() - time the write of the default tables
+ * @core: Core device structure, locked by the caller
+ * @buf:  buffer for the report
+ * @size: size of @buf
+ *
+ * Writes the complete default table of the common properties and of
+ * the running receiver, then restores the cached configuration. Only
+ * meant for debugging, the application has to be running.
+ *
+ * Returns the length of the report or a negative error code.
+ */
+int si468x_core_bench_properties(struct si468x_core *core,
+				 char *buf, size_t size)
+{
+	const struct regmap_config *config;
+	struct regmap *map;
+	int len, err;
+
+	switch (core->power_up_parameters.func) {
+	case SI468X_FUNC_AM_RECEIVER:
+		config = &si468x_am_regmap_config;
+		map = core->regmap_am;
+		break;
+	case SI468X_FUNC_FM_RECEIVER:
+		config = &si468x_fm_regmap_config;
+		map = core->regmap_fm;
+		break;
+	case SI468X_FUNC_DAB_RECEIVER:
+		config = &si468x_dab_regmap_config;
+		map = core->regmap_dab;
+		break;
+	default:
+		return -ENODEV;
+	}
+
+	if (core->chip_state != SI468X_STATE_APPLICATION_RUNNING)
+		return -EIO;
+
+	err = si468x_core_bench_table(core, "common",
+				      si468x_common_reg_defaults,
+				      ARRAY_SIZE(si468x_common_reg_defaults),
+				      buf, size);
+	if (err < 0)
+		return err;
+	len = err;
+
+	err = si468x_core_bench_table(core, config->name + strlen("si468x_"),
+				      config->reg_defaults,
+				      config->num_reg_defaults,
+				      buf + len, size - len);
+	if (err < 0)
+		return err;
+	len += err;
+
+	/* the chip runs the defaults now, bring back the configuration */
+	err = si468x_core_sync_properties(core, core->regmap_common);
+	if (err < 0)
+		return err;
+	len += scnprintf(buf + len, size - len,
+			 "sync common: %u properties in %lld us\n",
+			 core->prop_sync_count, core->prop_sync_usecs);
+
+	err = si468x_core_sync_properties(core, map);
+	if (err < 0)
+		return err;
+	len += scnprintf(buf + len, size - len,
+			 "sync %s: %u properties in %lld us\n",
+			 config->name + strlen("si468x_"),
+			 core->prop_sync_count, core->prop_sync_usecs);
+
+	return len;
+}
@@ -0,0 +1,376 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * drivers/mfd/si468x-rds.c -- RDS decoder of si468x chips
+ *
+ * Copyright (C) 2020 HTL Steyr - Austria
+ * Copyright (C) 2020 Franz Parzer
+ *
+ * Author: Franz Parzer <rpi-receiver@htl-steyr.ac.at>
+ *
+ * The groups read by the RDS drainer are decoded (IEC 62106) into
+ * core->rds: PI, PTY, TP, TA, M/S, the program service name, the radio
+ * text, the clock time and the alternative frequencies of method A.
+ * Names and texts are only published once all of their segments were
+ * received without a conflicting repetition. The decoder runs with the
+ * core lock held, readers of core->rds take its seqlock.
+ */
+#include <linux/module.h>
+#include <linux/delay.h>
+#include <linux/string.h>
+
+#include <linux/mfd/si468x-core.h>
+#include "si468x-cmd_priv.h"
+
+#define SI468X_RDS_GROUP_0A	0x00
+#define SI468X_RDS_GROUP_0B	0x01
+#define SI468X_RDS_GROUP_2A	0x04
+#define SI468X_RDS_GROUP_2B	0x05
+#define SI468X_RDS_GROUP_4A	0x08
+
+/* AF codes, IEC 62106 6.2.1.6 */
+#define SI468X_RDS_AF_FIRST	1
+#define SI468X_RDS_AF_LAST	204
+#define SI468X_RDS_AF_LFMF	250
+
+#define SI468X_RDS_CR		0x0d
+#define SI468X_RDS_ALL		(SI468X_RDS_PI | SI468X_RDS_PTY | \
+				 SI468X_RDS_TP | SI468X_RDS_TA | \
+				 SI468X_RDS_MS | SI468X_RDS_PS | \
+				 SI468X_RDS_RT | SI468X_RDS_CT | \
+				 SI468X_RDS_AF)
+
+static u16 si468x_rds_block(const struct si468x_rds_status_report *report,
+			    int block)
+{
+	return report->rds[block].msb << 8 | report->rds[block].lsb;
+}
+
+/* the report keeps the BLE bits in place, block A in bits 7:6 */
+static bool si468x_rds_block_ok(const struct si468x_rds_status_report *report,
+				int block, u8 max_ble)
+{
+	return (report->ble[block] >> (6 - 2 * block)) <= max_ble;
+}
+
+static char si468x_rds_char(u8 c)
+{
+	return c < 0x20 ? ' ' : c;
+}
+
+static void si468x_rds_publish(struct si468x_core *core,
+			       struct si468x_rds *rds, u32 changed)
+{
+	rds->changed = changed;
+	rds->change++;
+
+	write_seqlock(&core->rds_lock);
+	core->rds = *rds;
+	write_sequnlock(&core->rds_lock);
+
+	sysfs_notify(&core->dev->kobj, NULL, "si468x_rds");
+	blocking_notifier_call_chain(&core->notifier, SI468X_EVENT_RDS,
+				     &core->rds);
+}
+
+static void si468x_rds_clear(struct si468x_core *core, struct si468x_rds *rds)
+{
+	u32 change = rds->change;
+
+	memset(rds, 0, sizeof(*rds));
+	rds->change = change;
+	memset(&core->rds_dec, 0, sizeof(core->rds_dec));
+}
+
+static u32 si468x_rds_ps(struct si468x_rds *rds,
+			 struct si468x_rds_decoder *dec, u8 seg, u16 d)
+{
+	char ch[2] = { si468x_rds_char(d >> 8), si468x_rds_char(d) };
+
+	/* a repetition that differs starts a new name */
+	if ((dec->ps_segs & BIT(seg)) && memcmp(dec->ps + 2 * seg, ch, 2))
+		dec->ps_segs = 0;
+	memcpy(dec->ps + 2 * seg, ch, 2);
+	dec->ps_segs |= BIT(seg);
+
+	if (dec->ps_segs != 0x0f || !memcmp(rds->ps, dec->ps, sizeof(dec->ps)))
+		return 0;
+
+	memcpy(rds->ps, dec->ps, sizeof(dec->ps));
+	rds->ps[SI468X_RDS_PS_LENGTH] = '\0';
+
+	return SI468X_RDS_PS;
+}
+
+static u32 si468x_rds_rt(struct si468x_rds *rds,
+			 struct si468x_rds_decoder *dec, bool ab, u8 seg,
+			 const u8 *chars, int width)
+{
+	int pos = seg * width, len = -1, i;
+	char buf[4];
+	u16 mask;
+
+	if (ab != dec->rt_ab || width != dec->rt_width) {
+		dec->rt_segs = 0;
+		dec->rt_ab = ab;
+		dec->rt_width = width;
+		dec->rt_len = 16 * width;
+	}
+
+	for (i = 0; i < width; i++) {
+		if (chars[i] == SI468X_RDS_CR) {
+			len = pos + i;
+			break;
+		}
+		buf[i] = si468x_rds_char(chars[i]);
+	}
+
+	if ((dec->rt_segs & BIT(seg)) &&
+	    (memcmp(dec->rt + pos, buf, i) ||
+	     (len < 0 && dec->rt_len < pos + width) ||
+	     (len >= 0 && dec->rt_len != len))) {
+		dec->rt_segs = 0;
+		dec->rt_len = 16 * width;
+	}
+	memcpy(dec->rt + pos, buf, i);
+	dec->rt_segs |= BIT(seg);
+	if (len >= 0)
+		dec->rt_len = len;
+
+	mask = GENMASK(DIV_ROUND_UP(dec->rt_len, width), 0) >> 1;
+	if ((dec->rt_segs & mask) != mask)
+		return 0;
+
+	/* the text is padded with spaces if it has no carriage return */
+	len = dec->rt_len;
+	while (len && dec->rt[len - 1] == ' ')
+		len--;
+	if (rds->rt_ab == ab && !rds->rt[len] &&
+	    !memcmp(rds->rt, dec->rt, len))
+		return 0;
+
+	memcpy(rds->rt, dec->rt, len);
+	rds->rt[len] = '\0';
+	rds->rt_ab = ab;
+
+	return SI468X_RDS_RT;
+}
+
+static u32 si468x_rds_ct(struct si468x_rds *rds, u16 b, u16 c, u16 d)
+{
+	u8 hour = (c & 0x01) << 4 | d >> 12;
+	u8 minute = (d >> 6) & 0x3f;
+
+	if (hour > 23 || minute > 59)
+		return 0;
+
+	rds->ct_valid = true;
+	rds->ct_mjd = (b & 0x03) << 15 | c >> 1;
+	rds->ct_hour = hour;
+	rds->ct_minute = minute;
+	rds->ct_offset = (d & 0x20) ? -(d & 0x1f) : (d & 0x1f);
+
+	return SI468X_RDS_CT;
+}
+
+static u32 si468x_rds_af(struct si468x_rds *rds, u16 c)
+{
+	u8 codes[2] = { c >> 8, c & 0xff };
+	u32 changed = 0, freq;
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(codes); i++) {
+		/* the next code is an LF/MF frequency */
+		if (codes[i] == SI468X_RDS_AF_LFMF)
+			break;
+		if (codes[i] < SI468X_RDS_AF_FIRST ||
+		    codes[i] > SI468X_RDS_AF_LAST)
+			continue;
+
+		freq = 87500 + codes[i] * 100;
+		for (j = 0; j < rds->nr_afs; j++)
+			if (rds->afs[j] == freq)
+				break;
+		if (j < rds->nr_afs || rds->nr_afs == SI468X_RDS_MAX_AFS)
+			continue;
+		rds->afs[rds->nr_afs++] = freq;
+		changed = SI468X_RDS_AF;
+	}
+
+	return changed;
+}
+
+/**
+ * si468x_rds_receive() - decode an RDS group
+ * @core:   core device, locked
+ * @report: group read with FM_RDS_STATUS
+ */
+void si468x_rds_receive(struct si468x_core *core,
+			const struct si468x_rds_status_report *report)
+{
+	struct si468x_rds_decoder *dec = &core->rds_dec;
+	struct si468x_rds rds = core->rds;
+	u16 b, c, d, pi = 0;
+	bool c_ok, d_ok;
+	u8 chars[4];
+	u32 changed = 0;
+	u8 type;
+
+	if (!si468x_rds_block_ok(report, V4L2_RDS_BLOCK_B, SI468X_RDS_MAX_BLE)) {
+		core->rds_bad_groups++;
+		return;
+	}
+	core->rds_groups++;
+
+	b = si468x_rds_block(report, V4L2_RDS_BLOCK_B);
+	c = si468x_rds_block(report, V4L2_RDS_BLOCK_C);
+	d = si468x_rds_block(report, V4L2_RDS_BLOCK_D);
+	c_ok = si468x_rds_block_ok(report, V4L2_RDS_BLOCK_C, SI468X_RDS_MAX_BLE);
+	d_ok = si468x_rds_block_ok(report, V4L2_RDS_BLOCK_D, SI468X_RDS_MAX_BLE);
+	type = b >> 11;
+
+	/* version B groups repeat the PI in block C */
+	if (si468x_rds_block_ok(report, V4L2_RDS_BLOCK_A, SI468X_RDS_MAX_BLE))
+		pi = si468x_rds_block(report, V4L2_RDS_BLOCK_A);
+	else if ((type & 0x01) && c_ok)
+		pi = c;
+
+	if (pi && pi != rds.pi) {
+		/* another station, forget everything of the last one */
+		if (rds.pi) {
+			si468x_rds_clear(core, &rds);
+			changed = SI468X_RDS_ALL;
+		}
+		rds.pi = pi;
+		changed |= SI468X_RDS_PI;
+	}
+
+	if (rds.pty != ((b >> 5) & 0x1f)) {
+		rds.pty = (b >> 5) & 0x1f;
+		changed |= SI468X_RDS_PTY;
+	}
+	if (rds.tp != !!(b & BIT(10))) {
+		rds.tp = b & BIT(10);
+		changed |= SI468X_RDS_TP;
+	}
+
+	switch (type) {
+	case SI468X_RDS_GROUP_0A:
+	case SI468X_RDS_GROUP_0B:
+		if (type == SI468X_RDS_GROUP_0A && c_ok)
+			changed |= si468x_rds_af(&rds, c);
+		if (rds.ta != !!(b & BIT(4))) {
+			rds.ta = b & BIT(4);
+			changed |= SI468X_RDS_TA;
+		}
+		if (rds.ms != !!(b & BIT(3))) {
+			rds.ms = b & BIT(3);
+			changed |= SI468X_RDS_MS;
+		}
+		if (d_ok)
+			changed |= si468x_rds_ps(&rds, dec, b & 0x03, d);
+		break;
+	case SI468X_RDS_GROUP_2A:
+		if (!c_ok || !d_ok)
+			break;
+		chars[0] = c >> 8;
+		chars[1] = c;
+		chars[2] = d >> 8;
+		chars[3] = d;
+		changed |= si468x_rds_rt(&rds, dec, b & BIT(4), b & 0x0f,
+					 chars, 4);
+		break;
+	case SI468X_RDS_GROUP_2B:
+		if (!d_ok)
+			break;
+		chars[0] = d >> 8;
+		chars[1] = d;
+		changed |= si468x_rds_rt(&rds, dec, b & BIT(4), b & 0x0f,
+					 chars, 2);
+		break;
+	case SI468X_RDS_GROUP_4A:
+		/* a wrong clock is worse than none */
+		if (si468x_rds_block_ok(report, V4L2_RDS_BLOCK_C, 0) &&
+		    si468x_rds_block_ok(report, V4L2_RDS_BLOCK_D, 0))
+			changed |= si468x_rds_ct(&rds, b, c, d);
+		break;
+	default:
+		break;
+	}
+
+	if (changed)
+		si468x_rds_publish(core, &rds, changed);
+}
+
+/**
+ * si468x_rds_reset() - forget the RDS of the last station
+ * @core: core device, locked
+ *
+ * Called when the chip is tuned or stopped.
+ */
+void si468x_rds_reset(struct si468x_core *core)
+{
+	struct si468x_rds rds = core->rds;
+
+	memset(&core->rds_dec, 0, sizeof(core->rds_dec));
+	if (!rds.pi && !rds.ps[0] && !rds.rt[0] && !rds.nr_afs &&
+	    !rds.ct_valid)
+		return;
+
+	si468x_rds_clear(core, &rds);
+	si468x_rds_publish(core, &rds, SI468X_RDS_ALL);
+}
+
+/**
+ * si468x_rds_wait_pi() - wait for the chip to decode the PI code
+ * @core:    core device, locked
+ * @timeout: time to wait in msecs
+ *
+ * Used after a tune, before the groups reach the decoder. Returns the
+ * PI code, -ETIMEDOUT or another negative error code.
+ */
+int si468x_rds_wait_pi(struct si468x_core *core, unsigned int timeout)
+{
+	struct si468x_rds_status_report report;
+	unsigned int waited;
+	int err;
+
+	for (waited = 0; waited < timeout; waited += SI468X_RDS_PI_POLL) {
+		msleep(SI468X_RDS_PI_POLL);
+		err = si468x_core_cmd_fm_rds_status(core, true, false, false,
+						    &report);
+		if (err < 0)
+			return err;
+		if (report.pivalid)
+			return report.pi;
+	}
+
+	return -ETIMEDOUT;
+}
+
+/**
+ * si468x_rds_flush() - drop the groups waiting in the chip
+ * @core: core device, locked
+ *
+ * Groups received on other frequencies must not reach the decoder.
+ */
+void si468x_rds_flush(struct si468x_core *core)
+{
+	core->rds_drain_left = 0;
+	si468x_core_cmd_fm_rds_status(core, false, true, true, NULL);
+}
+
+/**
+ * si468x_core_read_rds() - copy the decoded RDS
+ * @core: core device, the core lock is not needed
+ * @rds:  receives the decoded fields
+ */
+void si468x_core_read_rds(struct si468x_core *core, struct si468x_rds *rds)
+{
+	unsigned int seq;
+
+	do {
+		seq = read_seqbegin(&core->rds_lock);
+		*rds = core->rds;
+	} while (read_seqretry(&core->rds_lock, seq));
+}
+EXPORT_SYMBOL_GPL(si468x_core_read_rds);
@@ -0,0 +1,447 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * drivers/mfd/si468x-scan.c -- FM/AM band scan of si468x chips
+ *
+ * Copyright (C) 2020 HTL Steyr - Austria
+ * Copyright (C) 2020 Franz Parzer
+ *
+ * Author: Franz Parzer <rpi-receiver@htl-steyr.ac.at>
+ *
+ * The band of the running FM or AM receiver is walked from the seek
+ * band bottom with the seek of the chip, which only stops on valid
+ * stations, until it reports the band limit. Every station is kept in
+ * core->analog_channels with its RSSI, SNR and, for FM with RDS
+ * enabled, its PI code. Once stations of the band are known, a scan
+ * only tunes to them again and removes those that are gone, unless a
+ * full scan is requested. The core lock is taken for every seek or
+ * tune, so other users of the chip are not locked out for the whole
+ * scan, and the scan can be cancelled between them. The receiver is
+ * tuned back to where it was at the end. While the scan runs, the RDS
+ * groups of the scanned stations are flushed instead of decoded, so
+ * the RDS of the station tuned before the scan stays published.
+ */
+#include <linux/module.h>
+#include <linux/slab.h>
+
+#include <linux/mfd/si468x-core.h>
+#include "si468x-cmd_priv.h"
+
+static u8 si468x_scan_band(struct si468x_core *core)
+{
+	switch (core->power_up_parameters.func) {
+	case SI468X_FUNC_FM_RECEIVER:
+		return SI468X_CHDB_FM;
+	case SI468X_FUNC_AM_RECEIVER:
+		return SI468X_CHDB_AM;
+	default:
+		return SI468X_CHDB_DAB;
+	}
+}
+
+/* the chip counts FM in 10 kHz, AM in 1 kHz */
+static u32 si468x_scan_khz(u8 band, u32 freq)
+{
+	return band == SI468X_CHDB_FM ? freq * 10 : freq;
+}
+
+static u32 si468x_scan_freq(u8 band, u32 khz)
+{
+	return band == SI468X_CHDB_FM ? khz / 10 : khz;
+}
+
+/* called with the core lock held before every step */
+static int si468x_scan_check(struct si468x_core *core, u8 band)
+{
+	if (READ_ONCE(core->scan.cancel) || !atomic_read(&core->is_alive) ||
+	    si468x_scan_band(core) != band)
+		return -ECANCELED;
+
+	return 0;
+}
+
+static int si468x_scan_measure(struct si468x_core *core, u8 band,
+			       struct si468x_rsq_status_report *rsq)
+{
+	struct si468x_rsq_status_args args = {
+		.rsqack		= false,
+		.attune		= false,
+		.cancel		= false,
+		.stcack		= false,
+	};
+
+	if (band == SI468X_CHDB_FM)
+		return si468x_core_cmd_fm_rsq_status(core, &args, rsq);
+
+	return si468x_core_cmd_am_rsq_status(core, &args, rsq);
+}
+
+static int si468x_scan_tune(struct si468x_core *core, u8 band, u32 freq)
+{
+	struct si468x_tune_freq_args args = {
+		.injside	= SI468X_INJSIDE_AUTO,
+		.freq		= freq,
+		.tunemode	= SI468X_TUNEMODE_FAST_NO_HD,
+		.antcap		= 0,
+		.direct_tune	= SI468X_SELECT_MAIN_PROGRAM_SERVICE,
+		.program_id	= 0,
+	};
+	int err;
+
+	core->scan.steps++;
+	if (band == SI468X_CHDB_AM)
+		return si468x_core_cmd_am_tune_freq(core, &args);
+
+	/* keeps the RDS of the station tuned before the scan */
+	err = __si468x_core_cmd_fm_tune_freq(core, &args);
+	si468x_rds_flush(core);
+
+	return err;
+}
+
+static int si468x_scan_seek(struct si468x_core *core, u8 band)
+{
+	const struct v4l2_hw_freq_seek seek = {
+		.seek_upward	= 1,
+		.wrap_around	= 0,
+	};
+	struct si468x_tune_freq_args args = {
+		.injside	= SI468X_INJSIDE_AUTO,
+		.tunemode	= SI468X_TUNEMODE_FAST_NO_HD,
+		.antcap		= 0,
+	};
+	int err;
+
+	core->scan.steps++;
+	if (band == SI468X_CHDB_AM)
+		return si468x_core_cmd_am_seek_start(core, &seek, &args);
+
+	err = si468x_core_cmd_fm_seek_start(core, &seek, &args);
+	si468x_rds_flush(core);
+
+	return err;
+}
+
+static struct si468x_dab_channel *si468x_scan_find(struct si468x_core *core,
+						   u8 band, u32 khz)
+{
+	struct si468x_dab_channel *ptr;
+
+	list_for_each_entry(ptr, &core->analog_channels.list, list)
+		if (ptr->band == band && ptr->frequency == khz)
+			return ptr;
+
+	return NULL;
+}
+
+static bool si468x_scan_rds_enabled(struct si468x_core *core)
+{
+	unsigned int val;
+
+	return !regmap_read(core->regmap_fm, SI468X_PROP_FM_RDS_CONFIG, &val) &&
+	       (val & SI468X_PROP_RDSEN);
+}
+
+/* add or update the station the receiver is tuned to */
+static int si468x_scan_record(struct si468x_core *core, u8 band,
+			      const struct si468x_rsq_status_report *rsq)
+{
+	struct si468x_chdb *db = &core->analog_channels;
+	u32 khz = si468x_scan_khz(band, rsq->readfreq);
+	struct si468x_dab_channel *old, *channel;
+	int pi = 0;
+
+	old = si468x_scan_find(core, band, khz);
+	/* FM and AM share the database */
+	if (!old && db->count >= 2 * SI468X_SCAN_MAX_STATIONS)
+		return -ENOSPC;
+
+	if (band == SI468X_CHDB_FM && si468x_scan_rds_enabled(core)) {
+		pi = si468x_rds_wait_pi(core, SI468X_SCAN_PI_TIMEOUT);
+		if (pi < 0)
+			pi = 0;
+	}
+	/* a station without RDS this time keeps the PI code it had */
+	if (!pi && old)
+		pi = old->service_id;
+
+	core->scan.found++;
+	if (old && old->service_id == pi) {
+		WRITE_ONCE(old->signal_strength, rsq->rssi);
+		WRITE_ONCE(old->snr, rsq->snr);
+		old->generation = db->generation;
+		return 0;
+	}
+
+	channel = si468x_chdb_alloc();
+	if (!channel)
+		return -ENOMEM;
+	channel->band = band;
+	channel->frequency = khz;
+	channel->service_id = pi;
+	channel->signal_strength = rsq->rssi;
+	channel->snr = rsq->snr;
+
+	/* the PI code is part of the key */
+	if (old)
+		si468x_chdb_del(db, old);
+	si468x_chdb_add(db, channel);
+
+	return 0;
+}
+
+static int si468x_scan_walk(struct si468x_core *core, u8 band)
+{
+	struct si468x_rsq_status_report rsq;
+	unsigned int bottom;
+	int i, err;
+
+	si468x_core_lock(core);
+	err = si468x_scan_check(core, band);
+	if (err < 0)
+		goto unlock;
+	if (band == SI468X_CHDB_FM)
+		err = regmap_read(core->regmap_fm,
+				  SI468X_PROP_FM_SEEK_BAND_BOTTOM, &bottom);
+	else
+		err = regmap_read(core->regmap_am,
+				  SI468X_PROP_AM_SEEK_BAND_BOTTOM, &bottom);
+	if (err < 0)
+		goto unlock;
+
+	/* the seek starts above the tuned frequency */
+	err = si468x_scan_tune(core, band, bottom);
+	if (err < 0)
+		goto unlock;
+	err = si468x_scan_measure(core, band, &rsq);
+	if (!(err < 0) && rsq.valid)
+		err = si468x_scan_record(core, band, &rsq);
+	si468x_core_unlock(core);
+	if (err < 0)
+		return err;
+
+	for (i = 0; i < SI468X_SCAN_MAX_STATIONS; i++) {
+		si468x_core_lock(core);
+		err = si468x_scan_check(core, band);
+		if (err < 0)
+			goto unlock;
+		err = si468x_scan_seek(core, band);
+		if (err < 0)
+			goto unlock;
+		err = si468x_scan_measure(core, band, &rsq);
+		if (err < 0)
+			goto unlock;
+		/* the seek stopped at the top of the band */
+		if (rsq.bltf) {
+			si468x_core_unlock(core);
+			return 0;
+		}
+		if (rsq.valid)
+			err = si468x_scan_record(core, band, &rsq);
+		si468x_core_unlock(core);
+		if (err < 0)
+			return err;
+	}
+
+	return 0;
+
+unlock:
+	si468x_core_unlock(core);
+
+	return err;
+}
+
+static int si468x_scan_revalidate(struct si468x_core *core, u8 band,
+				  const u32 *known, int nr_known)
+{
+	struct si468x_dab_channel *old;
+	struct si468x_rsq_status_report rsq;
+	int i, err;
+
+	for (i = 0; i < nr_known; i++) {
+		si468x_core_lock(core);
+		err = si468x_scan_check(core, band);
+		if (err < 0)
+			goto unlock;
+		err = si468x_scan_tune(core, band,
+				       si468x_scan_freq(band, known[i]));
+		if (err < 0)
+			goto unlock;
+		err = si468x_scan_measure(core, band, &rsq);
+		if (err < 0)
+			goto unlock;
+
+		if (rsq.valid) {
+			err = si468x_scan_record(core, band, &rsq);
+		} else {
+			old = si468x_scan_find(core, band, known[i]);
+			if (old) {
+				si468x_chdb_del(&core->analog_channels, old);
+				core->scan.dropped++;
+			}
+		}
+		si468x_core_unlock(core);
+		if (err < 0)
+			return err;
+	}
+
+	return 0;
+
+unlock:
+	si468x_core_unlock(core);
+
+	return err;
+}
+
+/* remove the stations of @band a full scan did not find again */
+static void si468x_scan_drop_stale(struct si468x_core *core, u8 band)
+{
+	struct si468x_chdb *db = &core->analog_channels;
+	struct si468x_dab_channel *ptr, *next;
+
+	list_for_each_entry_safe(ptr, next, &db->list, list) {
+		if (ptr->band == band && ptr->generation != db->generation) {
+			si468x_chdb_del(db, ptr);
+			core->scan.dropped++;
+		}
+	}
+}
+
+static void si468x_scan_work(struct work_struct *work)
+{
+	struct si468x_core *core = container_of(work, struct si468x_core,
+						scan.work);
+	struct si468x_scan *scan = &core->scan;
+	struct si468x_rsq_status_report rsq;
+	struct si468x_dab_channel *ptr;
+	u32 *known = NULL, orig;
+	int nr_known = 0;
+	u8 band;
+	int err;
+
+	si468x_core_lock(core);
+	band = scan->band;
+	err = si468x_scan_check(core, band);
+	if (err < 0)
+		goto done;
+	err = si468x_scan_measure(core, band, &rsq);
+	if (err < 0)
+		goto done;
+	orig = rsq.readfreq;
+
+	if (!scan->full) {
+		known = kmalloc_array(SI468X_SCAN_MAX_STATIONS, sizeof(*known),
+				      GFP_KERNEL);
+		if (!known) {
+			err = -ENOMEM;
+			goto done;
+		}
+		list_for_each_entry(ptr, &core->analog_channels.list, list)
+			if (ptr->band == band &&
+			    nr_known < SI468X_SCAN_MAX_STATIONS)
+				known[nr_known++] = ptr->frequency;
+	}
+	core->analog_channels.generation++;
+	si468x_core_unlock(core);
+
+	if (nr_known)
+		err = si468x_scan_revalidate(core, band, known, nr_known);
+	else
+		err = si468x_scan_walk(core, band);
+	kfree(known);
+
+	si468x_core_lock(core);
+	if (!nr_known && !(err < 0))
+		si468x_scan_drop_stale(core, band);
+
+	/* stopped or switched to another receiver, nothing to go back to */
+	if (atomic_read(&core->is_alive) && si468x_scan_band(core) == band) {
+		if (si468x_scan_tune(core, band, orig) < 0)
+			dev_warn(core->dev, "Could not tune back after the scan\n");
+	}
+done:
+	if (err < 0 && err != -ECANCELED)
+		dev_warn(core->dev, "Band scan failed (%d)\n", err);
+	else if (!(err < 0))
+		scan->scans++;
+	scan->running = false;
+	si468x_core_unlock(core);
+
+	sysfs_notify(&core->dev->kobj, NULL, "si468x_band_scan");
+	sysfs_notify(&core->dev->kobj, NULL, "si468x_station_list");
+}
+
+/**
+ * si468x_scan_start() - scan the band of the running receiver
+ * @core: core device
+ * @full: walk the whole band even if stations are known
+ *
+ * Returns -EINVAL if neither the FM nor the AM receiver runs and
+ * -EBUSY if a scan is running.
+ */
+int si468x_scan_start(struct si468x_core *core, bool full)
+{
+	struct si468x_scan *scan = &core->scan;
+	int err = 0;
+
+	si468x_core_lock(core);
+	if (!atomic_read(&core->is_alive) ||
+	    si468x_scan_band(core) == SI468X_CHDB_DAB) {
+		err = -EINVAL;
+	} else if (scan->running) {
+		err = -EBUSY;
+	} else {
+		scan->running = true;
+		scan->full = full;
+		WRITE_ONCE(scan->cancel, false);
+		scan->band = si468x_scan_band(core);
+		scan->steps = 0;
+		scan->found = 0;
+		scan->dropped = 0;
+		queue_work(system_wq, &scan->work);
+	}
+	si468x_core_unlock(core);
+
+	return err;
+}
+
+/**
+ * si468x_scan_cancel() - stop the running scan after the current step
+ * @core: core device
+ *
+ * The stations found so far are kept, no station is removed.
+ */
+void si468x_scan_cancel(struct si468x_core *core)
+{
+	WRITE_ONCE(core->scan.cancel, true);
+}
+
+/**
+ * si468x_scan_show() - describe the scan state for sysfs
+ * @core: core device, locked
+ * @buf:  output buffer
+ * @size: size of @buf
+ */
+int si468x_scan_show(struct si468x_core *core, char *buf, size_t size)
+{
+	struct si468x_scan *scan = &core->scan;
+
+	return scnprintf(buf, size,
+			 "%s %s %s steps %u found %u dropped %u scans %u\n",
+			 scan->running ? "running" : "idle",
+			 scan->band == SI468X_CHDB_AM ? "am" : "fm",
+			 scan->full ? "full" : "incremental",
+			 scan->steps, scan->found, scan->dropped, scan->scans);
+}
+
+void si468x_scan_init(struct si468x_core *core)
+{
+	si468x_chdb_init(&core->analog_channels);
+	INIT_WORK(&core->scan.work, si468x_scan_work);
+}
+
+void si468x_scan_exit(struct si468x_core *core)
+{
+	si468x_scan_cancel(core);
+	cancel_work_sync(&core->scan.work);
+	si468x_chdb_clear(&core->analog_channels);
+}
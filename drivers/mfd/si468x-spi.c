@@ -27,16 +27,15 @@
 static int si468x_spi_write(struct si468x_core *core,
 			      char *buf, int count)
 {
-	static int io_errors_count;
 	struct spi_device *spi = to_spi_device(core->dev);
 	int err;
 
 	err = spi_write(spi, buf, count);
 	if (err < 0) {
-		if (io_errors_count++ > SI468X_MAX_IO_ERRORS)
+		if (core->io_errors_count++ > SI468X_MAX_IO_ERRORS)
 			si468x_core_pronounce_dead(core);
 	} else {
-		io_errors_count = 0;
+		core->io_errors_count = 0;
 	}
 
 	return (err < 0) ? err : count;
@@ -45,7 +44,6 @@ static int si468x_spi_write(struct si468x_core *core,
 static int si468x_spi_read(struct si468x_core *core,
 			     char *buf, int count)
 {
-	static int io_errors_count;
 	struct spi_device *spi = to_spi_device(core->dev);
 	char *rx_buf;
 	int err;
@@ -58,19 +56,84 @@ static int si468x_spi_read(struct si468x_core *core,
 	memcpy(buf, rx_buf + 1, count);
 	kfree(rx_buf);
 	if (err < 0) {
-		if (io_errors_count++ > SI468X_MAX_IO_ERRORS)
+		if (core->io_errors_count++ > SI468X_MAX_IO_ERRORS)
 			si468x_core_pronounce_dead(core);
 	} else {
-		io_errors_count = 0;
+		core->io_errors_count = 0;
 	}
 
 	return (err < 0) ? err : count;
 }
 
+static int si468x_spi_write_sg(struct si468x_core *core,
+			       const char *hdr, int hdr_count,
+			       const char *buf, int count)
+{
+	struct spi_device *spi = to_spi_device(core->dev);
+	struct spi_transfer xfers[] = {
+		{
+			.tx_buf	= hdr,
+			.len	= hdr_count,
+		},
+		{
+			.tx_buf	= buf,
+			.len	= count,
+		},
+	};
+	int err;
+
+	err = spi_sync_transfer(spi, xfers, ARRAY_SIZE(xfers));
+	if (err < 0) {
+		if (core->io_errors_count++ > SI468X_MAX_IO_ERRORS)
+			si468x_core_pronounce_dead(core);
+	} else {
+		core->io_errors_count = 0;
+	}
+
+	return (err < 0) ? err : hdr_count + count;
+}
+
+/*
+ * The opcode and the reply share one full duplex transfer, the byte
+ * clocked in while the opcode goes out is dummy and skipped in place.
+ * The core buffers hold the longest reply the core requests.
+ */
+static int si468x_spi_read_reply(struct si468x_core *core,
+				 u8 *buf, int count)
+{
+	struct spi_device *spi = to_spi_device(core->dev);
+	struct spi_transfer xfer = {
+		.tx_buf	= core->bus_tx_buf,
+		.rx_buf	= core->bus_rx_buf,
+		.len	= count + 1,
+	};
+	char command = 0x00; /* CMD_RD_REPLY */
+	int err;
+
+	if (count + 1 > SI468X_BUS_BUF_BYTES)
+		return -EINVAL;
+
+	/* CMD_RD_REPLY is 0x00, the rest of the buffer stays zero */
+	core->bus_tx_buf[0] = command;
+	err = spi_sync_transfer(spi, &xfer, 1);
+	if (err < 0) {
+		if (core->io_errors_count++ > SI468X_MAX_IO_ERRORS)
+			si468x_core_pronounce_dead(core);
+		return err;
+	}
+	core->io_errors_count = 0;
+
+	memcpy(buf, core->bus_rx_buf + 1, count);
+
+	return count;
+}
+
 const struct si468x_bus_ops si468x_spi_bus_ops = {
 	.bustype	= BUS_SPI,
 	.write		= si468x_spi_write,
 	.read		= si468x_spi_read,
+	.write_sg	= si468x_spi_write_sg,
+	.read_reply	= si468x_spi_read_reply,
 };
 
 static int si468x_spi_probe(struct spi_device *spi)
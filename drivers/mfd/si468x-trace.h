@@ -0,0 +1,125 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * drivers/mfd/si468x-trace.h -- Trace events of the si468x command
+ * protocol
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM si468x
+
+#if !defined(_SI468X_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _SI468X_TRACE_H
+
+#include <linux/device.h>
+#include <linux/tracepoint.h>
+
+/**
+ * si468x_cmd - a command completed (or failed)
+ * @opcode: command id
+ * @argn: number of argument bytes sent
+ * @respn: number of reply bytes requested
+ * @cts_us: time from sending the command until CTS was seen
+ * @status: first status byte of the reply (CTS/ERR/STC/...)
+ * @error: error code byte of the reply, only valid if ERR is set
+ * @chip_state: enum si468x_chip_state after evaluating the reply
+ * @ret: return value of the command
+ */
+TRACE_EVENT(si468x_cmd,
+	TP_PROTO(struct device *dev, u8 opcode, int argn, int respn,
+		 s64 cts_us, u8 status, u8 error, int chip_state, int ret),
+	TP_ARGS(dev, opcode, argn, respn, cts_us, status, error,
+		chip_state, ret),
+	TP_STRUCT__entry(
+		__string(dev, dev_name(dev))
+		__field(u8, opcode)
+		__field(int, argn)
+		__field(int, respn)
+		__field(s64, cts_us)
+		__field(u8, status)
+		__field(u8, error)
+		__field(int, chip_state)
+		__field(int, ret)
+	),
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__entry->opcode = opcode;
+		__entry->argn = argn;
+		__entry->respn = respn;
+		__entry->cts_us = cts_us;
+		__entry->status = status;
+		__entry->error = error;
+		__entry->chip_state = chip_state;
+		__entry->ret = ret;
+	),
+	TP_printk("%s cmd=0x%02x argn=%d respn=%d cts=%lldus status=0x%02x error=0x%02x chip_state=%d ret=%d",
+		  __get_str(dev), __entry->opcode, __entry->argn,
+		  __entry->respn, __entry->cts_us, __entry->status,
+		  __entry->error, __entry->chip_state, __entry->ret)
+);
+
+/**
+ * si468x_status - status bytes read by the interrupt dispatcher
+ * @status0: first status byte (CTS/ERR/STC/RDS/DSRV/DACQ)
+ * @status1: second status byte (DEVNT)
+ * @chip_state: enum si468x_chip_state when the status was read
+ */
+TRACE_EVENT(si468x_status,
+	TP_PROTO(struct device *dev, u8 status0, u8 status1, int chip_state),
+	TP_ARGS(dev, status0, status1, chip_state),
+	TP_STRUCT__entry(
+		__string(dev, dev_name(dev))
+		__field(u8, status0)
+		__field(u8, status1)
+		__field(int, chip_state)
+	),
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__entry->status0 = status0;
+		__entry->status1 = status1;
+		__entry->chip_state = chip_state;
+	),
+	TP_printk("%s status=0x%02x 0x%02x chip_state=%d",
+		  __get_str(dev), __entry->status0, __entry->status1,
+		  __entry->chip_state)
+);
+
+/**
+ * si468x_tune - a tune or seek command completed
+ * @opcode: command id
+ * @stc_us: time from sending the command until STC was seen
+ * @status: first status byte of the command reply
+ * @chip_state: enum si468x_chip_state after the tune
+ * @ret: return value of the command
+ */
+TRACE_EVENT(si468x_tune,
+	TP_PROTO(struct device *dev, u8 opcode, s64 stc_us, u8 status,
+		 int chip_state, int ret),
+	TP_ARGS(dev, opcode, stc_us, status, chip_state, ret),
+	TP_STRUCT__entry(
+		__string(dev, dev_name(dev))
+		__field(u8, opcode)
+		__field(s64, stc_us)
+		__field(u8, status)
+		__field(int, chip_state)
+		__field(int, ret)
+	),
+	TP_fast_assign(
+		__assign_str(dev, dev_name(dev));
+		__entry->opcode = opcode;
+		__entry->stc_us = stc_us;
+		__entry->status = status;
+		__entry->chip_state = chip_state;
+		__entry->ret = ret;
+	),
+	TP_printk("%s cmd=0x%02x stc=%lldus status=0x%02x chip_state=%d ret=%d",
+		  __get_str(dev), __entry->opcode, __entry->stc_us,
+		  __entry->status, __entry->chip_state, __entry->ret)
+);
+
+#endif /* _SI468X_TRACE_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE si468x-trace
+#include <trace/define_trace.h>
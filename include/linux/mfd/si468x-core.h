@@ -16,7 +16,11 @@
 #ifndef SI468X_CORE_H
 #define SI468X_CORE_H
 
-#include <linux/kfifo.h>
+#include <linux/miscdevice.h>
+#include <linux/notifier.h>
+#include <linux/hashtable.h>
+#include <linux/rcupdate.h>
+#include <linux/seqlock.h>
 #include <linux/regmap.h>
 #include <linux/mfd/core.h>
 #include <linux/of_device.h>
@@ -27,8 +31,28 @@
 #include <linux/mfd/si468x-reports.h>
 
 #define SI468X_MAX_HOST_LOAD_BYTES 512
+#define SI468X_MAX_HOST_LOAD_CHUNK 4096
+#define SI468X_FW_IMAGES (SI468X_FUNC_DAB_RECEIVER + 1)
+#define SI468X_CMD_OPCODES 256
+#define SI468X_MAX_REPLY_BYTES 64
+/* reply bytes fetched per READ_OFFSET command */
+#define SI468X_READ_OFFSET_CHUNK 256
+/* longest reply the core reads, a READ_OFFSET chunk behind 4 status bytes */
+#define SI468X_MAX_BUS_REPLY_BYTES (4 + SI468X_READ_OFFSET_CHUNK)
+/* RD_REPLY opcode/dummy byte plus the longest reply */
+#define SI468X_BUS_BUF_BYTES (SI468X_MAX_BUS_REPLY_BYTES + 1)
 #define SI468X_DAB_MAX_FREQUENCIES 48
 #define SI468X_DAB_DL_PLUS_MAX_TEXT_LENGTH 128
+#define SI468X_DAB_DL_PLUS_MAX_TAGS 4
+#define SI468X_FOLLOW_MAX_IDS 16
+#define SI468X_FOLLOW_MAX_FREQS 32
+#define SI468X_FOLLOW_RSSI_LOW_DEFAULT 10
+#define SI468X_RDS_LATENCY_DEFAULT 2000
+#define SI468X_RDS_PS_LENGTH 8
+#define SI468X_RDS_RT_LENGTH 64
+#define SI468X_RDS_MAX_AFS 25
+#define SI468X_AF_RSSI_LOW_DEFAULT 20
+#define SI468X_AF_SNR_LOW_DEFAULT 6
 
 #define FREQ_MUL (10000000 / 625)
 
@@ -37,6 +61,7 @@
 #define SI468X_TIMEOUT_TUNE	700000
 #define SI468X_TIMEOUT_BOOT	300000
 #define SI468X_TIMEOUT_CRC	5000000
+#define SI468X_TIMEOUT_ERASE	500000
 #define SI468X_TIMEOUT_LOAD	0
 #define SI468X_TIMEOUT_POWER_UP	20
 
@@ -122,6 +147,364 @@ enum si468x_nvm_state {
 	SI468X_STATE_NVM_READY,
 };
 
+/**
+ * struct si468x_dab_frequency - the structure representing
+ * one dab frequency info
+ *
+ * @name: name of the block
+ * @frequency: mid frequency of block in kHz
+ * @is_active: is part of si468x freq_list
+ * @is_valid: ensemble was detected
+  */
+struct si468x_dab_frequency {
+	const char *name;
+	u32   frequency;
+	bool  is_active;
+	bool  is_valid;
+};
+
+#define SI468X_CHDB_HASH_BITS	8
+
+enum si468x_chdb_band {
+	SI468X_CHDB_DAB		= 0,
+	SI468X_CHDB_FM		= 1,
+	SI468X_CHDB_AM		= 2,
+};
+
+/**
+ * struct si468x_chdb - channel database, see si468x-chdb.c
+ *
+ * @list: entries in the order they were found (RCU list)
+ * @index: entries hashed by frequency, service id and subchannel
+ * @count: number of entries
+ * @generation: bumped by the writer before an update, entries added or
+ * replaced afterwards carry the new value
+ */
+struct si468x_chdb {
+	struct list_head list;
+	DECLARE_HASHTABLE(index, SI468X_CHDB_HASH_BITS);
+	unsigned int     count;
+	unsigned int     generation;
+};
+
+/**
+ * struct si468x_mot_object - reassembled MOT object, see si468x-mot.c
+ *
+ * @seq: number of the object since probe, 0 for none
+ * @service_id: service the object was transported in
+ * @transport_id: MOT transport id
+ * @content_type: MOT content type, 2 for images
+ * @content_subtype: MOT content subtype, 1 for JPEG, 3 for PNG
+ * @size: bytes of @data
+ * @rcu: frees a replaced image once its readers are done
+ * @data: body of the object
+ */
+struct si468x_mot_object {
+	u32 seq;
+	u32 service_id;
+	u16 transport_id;
+	u16 content_type;
+	u16 content_subtype;
+	u32 size;
+	struct rcu_head rcu;
+	u8  data[];
+};
+
+/**
+ * struct si468x_dl_plus_tag - DL Plus tag, ETSI TS 102 980
+ * @content_type: content type of the tagged text, e.g. 1 for the title
+ * @start: first character of the tagged text in the label
+ * @length: number of tagged characters
+ */
+struct si468x_dl_plus_tag {
+	u8 content_type;
+	u8 start;
+	u8 length;
+};
+
+/**
+ * struct si468x_dls - dynamic label of the running DAB service
+ * @text: label, zero terminated
+ * @toggle: toggle bit of the label, flips with each new label
+ * @change: incremented for each new label or new set of tags
+ * @item_toggle: DL Plus item toggle, flips with each new item
+ * @item_running: the item (e.g. the song) is running
+ * @nr_tags: valid entries of @tags, 0 until a DL Plus command arrived
+ * @tags: DL Plus tags of @text
+ */
+struct si468x_dls {
+	char text[SI468X_DAB_DL_PLUS_MAX_TEXT_LENGTH];
+	bool toggle;
+	u32  change;
+	bool item_toggle;
+	bool item_running;
+	u8   nr_tags;
+	struct si468x_dl_plus_tag tags[SI468X_DAB_DL_PLUS_MAX_TAGS];
+};
+
+/**
+ * struct si468x_follow_freq - entry of the DAB frequency information
+ * @id: ensemble id for DAB, PI code for FM with RDS
+ * @freq: frequency in kHz
+ * @rnm: range and modulation, enum si468x_fi_rnm
+ */
+struct si468x_follow_freq {
+	u32 id;
+	u32 freq;
+	u8  rnm;
+};
+
+enum si468x_fi_rnm {
+	SI468X_FI_RNM_DAB	= 0,
+	SI468X_FI_RNM_FM_RDS	= 8,
+	SI468X_FI_RNM_FM	= 9,
+};
+
+/**
+ * struct si468x_follow - service following state, see si468x-follow.c
+ * @enabled: switch to a linked service when the reception degrades
+ * @rssi_low: RSSI in dBuV below which the reception is degraded
+ * @service_id: service the linking sets were read for, 0 if none
+ * @sids: services hard linked to @service_id in other ensembles
+ * @nr_sids: valid entries of @sids
+ * @pis: PI codes of FM services hard linked to @service_id
+ * @nr_pis: valid entries of @pis
+ * @freqs: frequency information of the tuned ensemble
+ * @nr_freqs: valid entries of @freqs
+ * @work: checks the reception after a DACQ interrupt
+ * @dab_switches: switches to another ensemble
+ * @fm_switches: switches to FM
+ * @failures: degradations without a working alternative
+ */
+struct si468x_follow {
+	bool enabled;
+	s8   rssi_low;
+	u32  service_id;
+	u32  sids[SI468X_FOLLOW_MAX_IDS];
+	int  nr_sids;
+	u16  pis[SI468X_FOLLOW_MAX_IDS];
+	int  nr_pis;
+	struct si468x_follow_freq freqs[SI468X_FOLLOW_MAX_FREQS];
+	int  nr_freqs;
+	struct delayed_work work;
+	u32  dab_switches;
+	u32  fm_switches;
+	u32  failures;
+};
+
+/**
+ * struct si468x_scan - FM/AM band scan state, see si468x-scan.c
+ * @work: walks the band or revalidates the known stations
+ * @running: a scan is queued or running
+ * @full: walk the whole band even if stations are known
+ * @cancel: stop the running scan after the current step
+ * @band: enum si468x_chdb_band being scanned
+ * @steps: seeks and tunes of the last scan
+ * @found: stations found or confirmed by the last scan
+ * @dropped: stations the last scan removed
+ * @scans: scans finished since probe
+ */
+struct si468x_scan {
+	struct work_struct work;
+	bool running;
+	bool full;
+	bool cancel;
+	u8   band;
+	u32  steps;
+	u32  found;
+	u32  dropped;
+	u32  scans;
+};
+
+/**
+ * struct si468x_af - FM alternative frequency switching, see si468x-af.c
+ * @enabled: retune to an alternative frequency when the reception degrades
+ * @rssi_low: RSSI in dBuV below which the reception is degraded
+ * @snr_low: SNR in dB below which the reception is degraded
+ * @quiet_until: no check before this time (in jiffies)
+ * @work: checks the reception after an RSQ interrupt
+ * @checks: degradations the alternative frequencies were checked for
+ * @switches: retunes to an alternative frequency
+ * @returns: checks that found nothing better and tuned back
+ * @failures: degradations without an AF list
+ */
+struct si468x_af {
+	bool enabled;
+	s8   rssi_low;
+	s8   snr_low;
+	unsigned long quiet_until;
+	struct delayed_work work;
+	u32  checks;
+	u32  switches;
+	u32  returns;
+	u32  failures;
+};
+
+/**
+ * enum si468x_rds_field - fields of struct si468x_rds
+ */
+enum si468x_rds_field {
+	SI468X_RDS_PI	= BIT(0),
+	SI468X_RDS_PTY	= BIT(1),
+	SI468X_RDS_TP	= BIT(2),
+	SI468X_RDS_TA	= BIT(3),
+	SI468X_RDS_MS	= BIT(4),
+	SI468X_RDS_PS	= BIT(5),
+	SI468X_RDS_RT	= BIT(6),
+	SI468X_RDS_CT	= BIT(7),
+	SI468X_RDS_AF	= BIT(8),
+};
+
+/**
+ * struct si468x_rds - decoded RDS of the tuned FM station, IEC 62106
+ * @change: incremented with each update
+ * @changed: enum si468x_rds_field mask of the last update
+ * @pi: program identification, 0 until received
+ * @pty: program type
+ * @tp: traffic program
+ * @ta: traffic announcement
+ * @ms: music (true) or speech
+ * @ps: program service name, zero terminated
+ * @rt: radio text, zero terminated
+ * @rt_ab: A/B flag of @rt
+ * @ct_valid: @ct_mjd and the following fields were received
+ * @ct_mjd: modified julian day of the clock time, UTC
+ * @ct_hour: hour, UTC
+ * @ct_minute: minute
+ * @ct_offset: local time offset in half hours
+ * @nr_afs: valid entries of @afs
+ * @afs: alternative frequencies in kHz (method A)
+ */
+struct si468x_rds {
+	u32  change;
+	u32  changed;
+	u16  pi;
+	u8   pty;
+	bool tp;
+	bool ta;
+	bool ms;
+	char ps[SI468X_RDS_PS_LENGTH + 1];
+	char rt[SI468X_RDS_RT_LENGTH + 1];
+	bool rt_ab;
+	bool ct_valid;
+	u32  ct_mjd;
+	u8   ct_hour;
+	u8   ct_minute;
+	s8   ct_offset;
+	u8   nr_afs;
+	u32  afs[SI468X_RDS_MAX_AFS];
+};
+
+/**
+ * struct si468x_rds_decoder - segments collected by the RDS decoder
+ * @ps: program service name being received
+ * @ps_segs: segments of @ps received, bit per segment
+ * @rt: radio text being received
+ * @rt_segs: segments of @rt received, bit per segment
+ * @rt_ab: A/B flag of @rt
+ * @rt_width: characters per segment of @rt, 4 for group 2A, 2 for 2B
+ * @rt_len: length of @rt, up to the carriage return if one was received
+ */
+struct si468x_rds_decoder {
+	char ps[SI468X_RDS_PS_LENGTH];
+	u8   ps_segs;
+	char rt[SI468X_RDS_RT_LENGTH];
+	u16  rt_segs;
+	bool rt_ab;
+	u8   rt_width;
+	u8   rt_len;
+};
+
+/**
+ * enum si468x_core_event - events sent through the core notifier
+ * @SI468X_EVENT_MOT_IMAGE: a slideshow image was published, the data
+ * is the struct si468x_mot_object. Sent with the core lock held.
+ * @SI468X_EVENT_DLS: a new dynamic label or new DL Plus tags, the data
+ * is the struct si468x_dls. Sent with the core lock held.
+ * @SI468X_EVENT_FOLLOW_FM: service following found no DAB alternative,
+ * the radio cell switches to the FM service of the struct
+ * si468x_follow_freq. Sent with the core lock held, the callback
+ * returns notifier_from_errno().
+ * @SI468X_EVENT_RDS: decoded RDS fields changed, the data is the struct
+ * si468x_rds. Sent with the core lock held.
+ */
+enum si468x_core_event {
+	SI468X_EVENT_MOT_IMAGE,
+	SI468X_EVENT_DLS,
+	SI468X_EVENT_FOLLOW_FM,
+	SI468X_EVENT_RDS,
+};
+
+/**
+ * struct si468x_fw_image - firmware image kept resident by the core
+ *
+ * @fw: image as returned by the firmware loader, NULL if not loaded.
+ * @crc: crc32 of the image as verified by the FLASH_LOAD CRC check.
+ * @in_nvm: the flash copy of the image matches @crc.
+ * @nvm_checked: @in_nvm is valid, the flash has been checked.
+ */
+struct si468x_fw_image {
+	const struct firmware *fw;
+	u32 crc;
+	bool in_nvm;
+	bool nvm_checked;
+};
+
+/**
+ * struct si468x_cmd_stats - CTS completion policy and statistics of
+ * one command opcode
+ *
+ * @poll_usecs: time to poll the status for CTS before falling back to
+ * the interrupt, 0 waits for the interrupt right away.
+ * @polled: commands that completed while polling.
+ * @poll_timeouts: polls that ran out of time.
+ * @irq_waits: commands that waited for the interrupt.
+ */
+struct si468x_cmd_stats {
+	u32 poll_usecs;
+	u32 polled;
+	u32 poll_timeouts;
+	u32 irq_waits;
+};
+
+/**
+ * enum si468x_cmd_prio - priority of requests for the command dispatcher
+ *
+ * @SI468X_PRIO_TUNE: tuning and service selection
+ * @SI468X_PRIO_DATA: draining audio related data (RDS, DLS)
+ * @SI468X_PRIO_STATUS: status polling and service list updates
+ * @SI468X_PRIO_COUNT: number of priorities
+ */
+enum si468x_cmd_prio {
+	SI468X_PRIO_TUNE,
+	SI468X_PRIO_DATA,
+	SI468X_PRIO_STATUS,
+	SI468X_PRIO_COUNT,
+};
+
+struct si468x_core;
+
+/**
+ * struct si468x_cmd_request - request for the command dispatcher
+ *
+ * @list: entry in the queue of @prio.
+ * @prio: priority, lower values run first.
+ * @fn: runs with the core locked. Returning -EAGAIN puts the request
+ * back at the tail of its queue, so long jobs can let other requests
+ * run between their steps.
+ * @complete: optional, called with the return value of @fn after the
+ * core was unlocked.
+ * @queued: the request is queued or running.
+ */
+struct si468x_cmd_request {
+	struct list_head     list;
+	enum si468x_cmd_prio prio;
+	int  (*fn)(struct si468x_core *core, struct si468x_cmd_request *req);
+	void (*complete)(struct si468x_core *core,
+			 struct si468x_cmd_request *req, int result);
+	bool                 queued;
+};
+
 /**
  * struct si468x_core - internal data structure representing the
  * underlying "core" device which all the MFD cell-devices use.
@@ -135,19 +518,24 @@ enum si468x_nvm_state {
  * si468x_core_lock()/si468x_core_unlock() should be used to get
  * exclusive access to the "core" device.
  * @rds_read_queue: Wait queue used to wait for RDS data.
- * @rds_fifo: FIFO in which all the RDS data received from the chip is
- * placed.
- * @rds_fifo_drainer: Worker that drains on-chip RDS FIFO.
- * @rds_drainer_is_working: Flag used for launching only one instance
- * of the @rds_fifo_drainer.
- * @rds_drainer_status_lock: Lock used to guard access to the
- * @rds_drainer_is_working variable.
- * @update_service_list: Worker that gets new service list.
- * @update_service_data: Worker that gets new service data.
- * @digital_service_drainer_is_working: Flag used for launching only one instance
- * of the @update_service_data.
- * @digital_service_drainer_status_lock: Lock used to guard access to the
- * @digital_service_drainer_is_working variable.
+ * @rds_ring_lock: protects @rds_ring and @rds_head.
+ * @rds_ring: the last SI468X_RDS_RING_BLOCKS RDS blocks received from
+ * the chip, every reader has its own cursor.
+ * @rds_head: number of blocks written to @rds_ring.
+ * @rds_overruns: blocks readers lost because they fell behind.
+ * @rds_last_read: jiffies of the last read of @rds_ring.
+ * @cmd_wq: ordered workqueue running @cmd_dispatcher.
+ * @cmd_dispatcher: Worker running the requests queued with
+ * si468x_core_submit().
+ * @cmd_queue_lock: Lock guarding @cmd_queue and the queued flags.
+ * @cmd_queue: queued requests, one list per enum si468x_cmd_prio.
+ * @cmd_lock_waiters: number of si468x_core_lock() callers waiting for
+ * @cmd_lock, the dispatcher does not start a new request while nonzero.
+ * @cmd_lock_idle: Wait queue woken when @cmd_lock_waiters drops to 0.
+ * @rds_drain_req: Request that drains on-chip RDS FIFO.
+ * @rds_drain_left: RDS groups still to be read by @rds_drain_req.
+ * @service_list_req: Request that gets new service list.
+ * @service_data_req: Request that gets new service data.
  * @command: Wait queue for wainting on the command comapletion.
  * @cts: Clear To Send flag set upon receiving first status with CTS
  * set.
@@ -162,13 +550,127 @@ enum si468x_nvm_state {
  * @supplies: Structure containing handles to all power supplies used
  * by the device (NULL ones are ignored).
  * @gpio_reset: GPIO pin connected to the RSTB pin of the chip.
- * @irq: Interrupt line.
+ * @irq: Interrupt line, 0 if the board has none and the status is
+ * polled.
+ * @status_poll: Worker polling the status every
+ * SI468X_STATUS_POLL_INTERVAL ms on boards without interrupt line.
  * @bus_ops: selects how to connect to the device (I2C or SPI).
+ * @bus_ops.write_sg: optional, writes @hdr followed by @buf as one
+ * transfer without copying @buf. Returns -EOPNOTSUPP if the bus can not
+ * do it, the core then falls back to @load_buf.
+ * @bus_ops.read_reply: optional, sends CMD_RD_REPLY and reads the reply
+ * as one transfer. Without it the core uses @bus_ops.write followed by
+ * @bus_ops.read.
  * @is_alive: signals valid communication with the device.
- * @rds_fifo_depth: device fifos configured by the module.
+ * @rds_fifo_depth: FM_RDS_INTERRUPT_FIFO_COUNT written to the chip,
+ * adapted to the group rate by the RDS drainer.
+ * @rds_latency_ms: longest time a group may wait in the chip FIFO, set
+ * with si468x_core_set_rds_latency().
+ * @rds_rate: average RDS group rate in groups per 1000 s.
+ * @rds_last_drain: time the last interrupt was drained, 0 after
+ * (re)starting RDS.
+ * @rds_interrupts: RDS interrupts drained.
+ * @rds_depth_changes: writes of FM_RDS_INTERRUPT_FIFO_COUNT by the
+ * drainer.
  * @err: signal error when reading with CMD_RD_REPLY.
  * @response_bytes: number of bytes to read with CMD_RD_REPLY.
  * @response: bytes read with CMD_RD_REPLY.
+ * @fw_cache: firmware images indexed by enum si468x_func, loaded once
+ * and kept until the core is removed.
+ * @fw_cache_hits: number of image requests served from @fw_cache.
+ * @fw_cache_misses: number of image requests sent to the firmware loader.
+ * @debugfs: debugfs directory of the core device.
+ * @host_load_chunk: number of image bytes sent per HOST_LOAD command.
+ * @load_buf: DMA-safe buffer for the command header of HOST_LOAD and
+ * flash writes, also used as bounce buffer for the image data.
+ * @read_offset_buf: DMA-safe buffer for one READ_OFFSET reply.
+ * @fw_auto_mirror: boot images from flash once they have been mirrored
+ * there, see @nvm_mirror_work.
+ * @nvm_mirror_pending: bitmask of enum si468x_func images that were
+ * loaded from the host and should be written to flash.
+ * @nvm_mirror_work: Worker that writes pending images to flash while
+ * the chip is powered down.
+ * @nvm_mirror_running: @nvm_mirror_work writes to flash, it stops before
+ * the next flash command if somebody waits for the core lock.
+ * @cmd_stats: CTS completion policy and statistics indexed by opcode.
+ * @prop_sync_active: SET_PROPERTY is streamed with polled CTS, set by
+ * si468x_core_sync_properties() while it runs.
+ * @prop_sync_count: properties written by the current or last sync.
+ * @prop_sync_usecs: duration of the last sync.
+ * @prop_bench_report: report of the last run of the debugfs file
+ * prop_sync_bench, empty if it failed.
+ * @bus_lock: serializes bus transfers of commands and the interrupt
+ * handler, so a status read can not split a command from its reply.
+ * @reply: reply of the pending command read by the interrupt handler.
+ * @reply_len: number of reply bytes the pending command expects, 0 if
+ * no command is pending or the reply does not fit into @reply.
+ * @reply_read: number of bytes in @reply handed to the waiter.
+ * @bus_tx_buf: DMA-safe transmit buffer of SI468X_BUS_BUF_BYTES for
+ * the bus backend, only used with @bus_lock held.
+ * @bus_rx_buf: DMA-safe receive buffer, same as @bus_tx_buf.
+ * @io_errors_count: consecutive failed bus transfers, the core is
+ * pronounced dead after SI468X_MAX_IO_ERRORS. Protected by @bus_lock.
+ * @dab_channels: DAB services found by this tuner. Changed with the
+ * core lock held, read under rcu_read_lock().
+ * @analog_channels: FM and AM stations found by the band scan, locked
+ * like @dab_channels.
+ * @scan: FM/AM band scan, changed with the core lock held.
+ * @loaded_dab_freq_list: DAB frequencies with a valid signal, as loaded
+ * into the chip with DAB_SET_FREQ_LIST. Zero terminated.
+ * @rds_lock: protects @rds, readers do not take the core lock.
+ * @rds: decoded RDS of the tuned FM station, written with the core lock
+ * held.
+ * @rds_dec: state of the RDS decoder, see si468x-rds.c.
+ * @rds_groups: RDS groups decoded.
+ * @rds_bad_groups: RDS groups dropped because of block errors.
+ * @dls_lock: protects @dls, readers do not take the core lock.
+ * @dls: dynamic label of the running service, written with the core
+ * lock held.
+ * @follow: service following, changed with the core lock held.
+ * @af: FM alternative frequency switching, changed with the core lock
+ * held.
+ * @dab_tuned_index: entry of @loaded_dab_freq_list the chip is tuned
+ * to, -1 if unknown.
+ * @zap_work: polls DAB_GET_AUDIO_INFO after a service change until
+ * audio is decoded.
+ * @zap_users: open file handles of the debugfs file dab_zap, service
+ * changes are only measured while it is open.
+ * @zap_start: time the last service change was requested.
+ * @zap_count: service changes that reached audio.
+ * @zap_timeouts: service changes without audio after
+ * SI468X_ZAP_TIMEOUT.
+ * @zap_last_us: latency from request to audio of the last change.
+ * @zap_min_us: shortest latency.
+ * @zap_max_us: longest latency.
+ * @dsrv_misc: character device streaming the DAB data service packets.
+ * @dsrv: ring of the character device, outlives the core while the
+ * device is open.
+ * @dsrv_head: bytes written to the ring. The copy in its control block
+ * is only published, never read back.
+ * @dsrv_scratch: receives the packets that are not stored in the ring.
+ * @dsrv_records: packets stored in the ring since probe.
+ * @dsrv_drops: packets dropped because the ring was full since probe.
+ * @mot_slots: MOT objects under reassembly, SI468X_MOT_SLOTS entries.
+ * @mot_image: last complete slideshow image, read under
+ * rcu_read_lock(). Never NULL after probe.
+ * @mot_spare: buffer a slot continues with when its object is
+ * published, NULL if it could not be allocated yet.
+ * @mot_dg: MSC data group joined from the chip segments.
+ * @mot_dg_len: bytes in @mot_dg.
+ * @mot_seq: sequence number of the last published image.
+ * @mot_evictions: partial objects dropped for a new one.
+ * @mot_errors: data groups dropped because of a bad CRC or header.
+ * @notifier: cells register here for enum si468x_core_event.
+ * @dab_svrlist_version: service list version merged into
+ * @dab_channels per entry of @loaded_dab_freq_list, -1 if none.
+ * @dab_svrlist_fetches: service lists read from the chip.
+ * @dab_svrlist_skips: service list events without a new version.
+ * @dab_cache_import: DAB cache blob collected from sysfs writes until
+ * it is complete.
+ * @dab_cache_import_len: bytes in @dab_cache_import.
+ * @dab_cache_export: DAB cache blob taken by a sysfs read at offset 0,
+ * the following pieces of the read are served from it.
+ * @dab_cache_export_len: bytes in @dab_cache_export.
  */
 
 struct si468x_core {
@@ -183,15 +685,22 @@ struct si468x_core {
 	struct mutex cmd_lock; /* for serializing fm radio operations */
 
 	wait_queue_head_t  rds_read_queue;
-	struct kfifo       rds_fifo;
-	struct work_struct rds_fifo_drainer;
-	bool               rds_drainer_is_working;
-	struct mutex       rds_drainer_status_lock;
-
-	struct work_struct update_service_list;
-	struct work_struct update_service_data;
-	bool               digital_service_drainer_is_working;
-	struct mutex       digital_service_drainer_status_lock;
+	spinlock_t         rds_ring_lock;
+	struct v4l2_rds_data *rds_ring;
+	u32                rds_head;
+	u32                rds_overruns;
+	unsigned long      rds_last_read;
+
+	struct workqueue_struct   *cmd_wq;
+	struct work_struct        cmd_dispatcher;
+	spinlock_t                cmd_queue_lock;
+	struct list_head          cmd_queue[SI468X_PRIO_COUNT];
+	atomic_t                  cmd_lock_waiters;
+	wait_queue_head_t         cmd_lock_idle;
+	struct si468x_cmd_request rds_drain_req;
+	int                       rds_drain_left;
+	struct si468x_cmd_request service_list_req;
+	struct si468x_cmd_request service_data_req;
 
 	wait_queue_head_t command;
 	atomic_t          cts;
@@ -210,22 +719,111 @@ struct si468x_core {
 	struct gpio_desc *gpio_reset;
 
 	int irq;
+	struct delayed_work status_poll;
 
 	const struct si468x_bus_ops {
 		u16 bustype;
 		int (*read)(struct si468x_core *core, char *buf, int count);
 		int (*write)(struct si468x_core *core, char *buf, int count);
+		int (*write_sg)(struct si468x_core *core,
+				const char *hdr, int hdr_count,
+				const char *buf, int count);
+		int (*read_reply)(struct si468x_core *core,
+				  u8 *buf, int count);
 	} *bus_ops;
 
 	atomic_t is_alive;
 
 	int rds_fifo_depth;
+	u32              rds_latency_ms;
+	u32              rds_rate;
+	ktime_t          rds_last_drain;
+	u32              rds_interrupts;
+	u32              rds_depth_changes;
 
 	atomic_t dab_full_scan;
 
-	struct si468x_dab_frequency *loaded_dab_freq_list;
-
-	char si468x_dls_message[SI468X_DAB_DL_PLUS_MAX_TEXT_LENGTH];
+	struct si468x_dab_frequency loaded_dab_freq_list[SI468X_DAB_MAX_FREQUENCIES];
+
+	seqlock_t        rds_lock;
+	struct si468x_rds rds;
+	struct si468x_rds_decoder rds_dec;
+	u32              rds_groups;
+	u32              rds_bad_groups;
+
+	seqlock_t        dls_lock;
+	struct si468x_dls dls;
+
+	struct si468x_fw_image fw_cache[SI468X_FW_IMAGES];
+	atomic_t fw_cache_hits;
+	atomic_t fw_cache_misses;
+
+	struct dentry *debugfs;
+
+	u32 host_load_chunk;
+	u8 *load_buf;
+	u8 *read_offset_buf;
+
+	bool               fw_auto_mirror;
+	unsigned long      nvm_mirror_pending;
+	struct work_struct nvm_mirror_work;
+	bool               nvm_mirror_running;
+
+	struct si468x_cmd_stats cmd_stats[SI468X_CMD_OPCODES];
+
+	bool         prop_sync_active;
+	unsigned int prop_sync_count;
+	s64          prop_sync_usecs;
+	char         prop_bench_report[256];
+
+	struct mutex bus_lock;
+	u8           reply[SI468X_MAX_REPLY_BYTES];
+	int          reply_len;
+	int          reply_read;
+	u8           *bus_tx_buf;
+	u8           *bus_rx_buf;
+	int          io_errors_count;
+
+	struct si468x_chdb dab_channels;
+	struct si468x_chdb analog_channels;
+	struct si468x_scan scan;
+	int              dab_svrlist_version[SI468X_DAB_MAX_FREQUENCIES];
+	int              dab_tuned_index;
+	struct si468x_follow follow;
+	struct si468x_af af;
+
+	struct delayed_work zap_work;
+	atomic_t         zap_users;
+	ktime_t          zap_start;
+	u32              zap_count;
+	u32              zap_timeouts;
+	s64              zap_last_us;
+	s64              zap_min_us;
+	s64              zap_max_us;
+	struct miscdevice dsrv_misc;
+	struct si468x_dsrv_stream *dsrv;
+	u32              dsrv_head;
+	u8               *dsrv_scratch;
+	u32              dsrv_records;
+	u32              dsrv_drops;
+
+	struct si468x_mot_slot *mot_slots;
+	struct si468x_mot_object __rcu *mot_image;
+	struct si468x_mot_object *mot_spare;
+	u8               *mot_dg;
+	u32              mot_dg_len;
+	u32              mot_seq;
+	u32              mot_evictions;
+	u32              mot_errors;
+
+	struct blocking_notifier_head notifier;
+
+	u32              dab_svrlist_fetches;
+	u32              dab_svrlist_skips;
+	u8               *dab_cache_import;
+	size_t           dab_cache_import_len;
+	u8               *dab_cache_export;
+	size_t           dab_cache_export_len;
 };
 
 /**
@@ -234,7 +832,11 @@ struct si468x_core {
  */
 static inline void si468x_core_lock(struct si468x_core *core)
 {
+	/* go ahead of the requests queued for the dispatcher */
+	atomic_inc(&core->cmd_lock_waiters);
 	mutex_lock(&core->cmd_lock);
+	if (atomic_dec_and_test(&core->cmd_lock_waiters))
+		wake_up(&core->cmd_lock_idle);
 }
 
 /**
@@ -335,22 +937,6 @@ struct si468x_rds_status_report {
 	struct v4l2_rds_data rds[4];
 };
 
-/**
- * struct si468x_dab_frequency - the structure representing
- * one dab frequency info
- *
- * @name: name of the block
- * @frequency: mid frequency of block in kHz
- * @is_active: is part of si468x freq_list
- * @is_valid: ensemble was detected
-  */
-struct si468x_dab_frequency {
-	const char *name;
-	u32   frequency;
-	bool  is_active;
-	bool  is_valid;
-};
-
 struct si468x_rsq_status_args {
 	bool rsqack;
 	bool digradack;
@@ -443,6 +1029,14 @@ struct si468x_dab_service_list {
  * @is_audio_service
  * @service_label
  * @component_info: aka Port Number or Program Number
+ * @is_started: the service is running
+ * @band: enum si468x_chdb_band, FM and AM stations use @frequency,
+ * @signal_strength, @snr and, for FM, the PI code as @service_id
+ * @snr: SNR in dB of FM and AM stations
+ * @generation: database generation of the last update
+ * @list: entry in &struct si468x_chdb list
+ * @node: entry in &struct si468x_chdb index
+ * @rcu: delayed free
  */
 struct si468x_dab_channel {
 	u16  version;
@@ -458,7 +1052,12 @@ struct si468x_dab_channel {
 	char service_label[16 + 1];
 	struct si468x_dab_component_info component_info;
 	bool is_started;
+	u8   band;
+	s8   snr;
+	unsigned int generation;
 	struct list_head list;
+	struct hlist_node node;
+	struct rcu_head rcu;
 };
 
 enum si468x_injside {
@@ -491,6 +1090,12 @@ int si468x_core_remove(struct si468x_core *);
 void si468x_core_suspend(struct si468x_core *);
 void si468x_core_resume(struct si468x_core *);
 void si468x_core_pronounce_dead(struct si468x_core *);
+bool si468x_core_submit(struct si468x_core *, struct si468x_cmd_request *);
+int si468x_core_register_notifier(struct si468x_core *,
+				  struct notifier_block *);
+int si468x_core_unregister_notifier(struct si468x_core *,
+				    struct notifier_block *);
+int si468x_core_read_offset(struct si468x_core *, u16, u8 *, int);
 int si468x_core_cmd_set_property(struct si468x_core *, u16, u16);
 int si468x_core_cmd_get_property(struct si468x_core *, u16);
 int si468x_core_cmd_am_seek_start(struct si468x_core *,
@@ -502,8 +1107,23 @@ int si468x_core_cmd_fm_seek_start(struct si468x_core *,
 int si468x_core_cmd_dab_seek_start(struct si468x_core *,
 				   const struct v4l2_hw_freq_seek *,
 				   struct si468x_tune_freq_args *);
+void si468x_core_dab_forget(struct si468x_core *);
+int si468x_core_dab_start_cached(struct si468x_core *);
+int si468x_core_cmd_dab_start_service(struct si468x_core *,
+				      struct si468x_dab_channel *);
+int si468x_core_cmd_dab_stop_service(struct si468x_core *,
+				     struct si468x_dab_channel *);
+int si468x_core_cmd_dab_get_service_linking_info(struct si468x_core *, u32,
+						 u8 *, int);
+int si468x_core_cmd_dab_get_freq_info(struct si468x_core *, u8 *, int);
 int si468x_core_cmd_fm_rds_status(struct si468x_core *, bool, bool, bool,
 				  struct si468x_rds_status_report *);
+int si468x_core_set_rds_latency(struct si468x_core *, u32);
+u32 si468x_core_rds_cursor(struct si468x_core *);
+bool si468x_core_rds_pending(struct si468x_core *, u32);
+int si468x_core_read_rds_blocks(struct si468x_core *, u32 *,
+				struct v4l2_rds_data *, int);
+void si468x_core_reset_rds_rate(struct si468x_core *);
 int si468x_core_cmd_fm_rds_blockcount(struct si468x_core *, bool,
 				      struct si468x_rds_blockcount_report *);
 int si468x_core_cmd_am_tune_freq(struct si468x_core *,
@@ -534,8 +1154,11 @@ int si468x_core_cmd_am_acf_status(struct si468x_core *,
 				  struct si468x_acf_status_report *);
 int si468x_core_cmd_fm_acf_status(struct si468x_core *,
 				  struct si468x_acf_status_report *);
+int si468x_core_cmd_dab_get_audio_info(struct si468x_core *,
+				       struct si468x_dab_audio_info_report *);
 int si468x_core_cmd_dab_acf_status(struct si468x_core *,
 				   struct si468x_acf_status_report *);
+int si468x_core_cmd_test_get_rssi(struct si468x_core *, s16 *);
 int si468x_core_cmd_agc_status(struct si468x_core *,
 			       struct si468x_agc_status_report *);
 
@@ -1120,6 +1743,20 @@ enum si468x_prop_dab_event_interrupt_source_config_bits {
 	SI468X_PROP_RECFG_INTEN_INTEN		= BIT(7),
 };
 
+enum si468x_prop_dab_digrad_interrupt_source_config_bits {
+	SI468X_PROP_RSSILINTEN			= BIT(0),
+	SI468X_PROP_RSSIHINTEN			= BIT(1),
+	SI468X_PROP_ACQINTEN			= BIT(2),
+	SI468X_PROP_FICERRINTEN			= BIT(3),
+};
+
+enum si468x_prop_fm_rsq_interrupt_source_config_bits {
+	SI468X_PROP_FM_RSSILIEN			= BIT(0),
+	SI468X_PROP_FM_RSSIHIEN			= BIT(1),
+	SI468X_PROP_FM_SNRLIEN			= BIT(2),
+	SI468X_PROP_FM_SNRHIEN			= BIT(3),
+};
+
 enum si468x_prop_dab_service_interrupt_source_config_bits {
 	SI468X_PROP_DSRV_INTEN_MASK		= BIT(0) | BIT(1),
 	SI468X_PROP_DSRVOVFLINT_INTEN		= BIT(0),
@@ -1127,5 +1764,32 @@ enum si468x_prop_dab_service_interrupt_source_config_bits {
 };
 
 int devm_regmap_init_si468x(struct si468x_core *);
+int si468x_core_sync_properties(struct si468x_core *, struct regmap *);
+int si468x_core_bench_properties(struct si468x_core *, char *, size_t);
+
+/* -------------------- si468x-follow.c ----------------------- */
+
+int si468x_core_set_service_following(struct si468x_core *, bool, s8);
+
+/* -------------------- si468x-af.c ----------------------- */
+
+int si468x_core_set_fm_af(struct si468x_core *, bool, s8, s8);
+
+/* -------------------- si468x-rds.c ----------------------- */
+
+void si468x_core_read_rds(struct si468x_core *, struct si468x_rds *);
+
+/* -------------------- si468x-chdb.c ----------------------- */
+
+void si468x_chdb_init(struct si468x_chdb *);
+struct si468x_dab_channel *si468x_chdb_alloc(void);
+void si468x_chdb_free(struct si468x_dab_channel *);
+void si468x_chdb_add(struct si468x_chdb *, struct si468x_dab_channel *);
+void si468x_chdb_replace(struct si468x_chdb *, struct si468x_dab_channel *,
+			 struct si468x_dab_channel *);
+void si468x_chdb_del(struct si468x_chdb *, struct si468x_dab_channel *);
+void si468x_chdb_clear(struct si468x_chdb *);
+struct si468x_dab_channel *si468x_chdb_find(struct si468x_chdb *,
+					    u32, u32, u8);
 
 #endif	/* SI468X_CORE_H */
@@ -75,6 +75,24 @@ struct si468x_acf_status_report {
 	__u16 cmft_noise_level;
 } __packed;
 
+/**
+ * si468x_dab_audio_info_report - audio of the running DAB service
+ * @bit_rate: audio bit rate in kbps, 0 while no audio is decoded
+ * @sample_rate: audio sample rate in Hz
+ * @ps_flag: parametric stereo is used
+ * @sbr_flag: spectral band replication is used
+ * @mode: dual, mono, stereo or joint stereo
+ * @drc_gain: dynamic range control gain
+ */
+struct si468x_dab_audio_info_report {
+	__u16 bit_rate;
+	__u16 sample_rate;
+	__u8  ps_flag;
+	__u8  sbr_flag;
+	__u8  mode;
+	__u8  drc_gain;
+} __packed;
+
 /**
  * si468x_agc_status_report
  */
@@ -98,4 +116,56 @@ struct si468x_rds_blockcount_report {
 	__u16 uncorrectable;
 } __packed;
 
+/**
+ * si468x_dsrv_ring - control block of the data service ring
+ * @size: bytes of the record area, a power of two
+ * @data_offset: offset of the record area from the start of the mapping
+ * @head: bytes written by the driver, free running
+ * @tail: bytes consumed by the reader, free running. Written by the
+ * reader after it is done with a record, read by the driver.
+ * @drops: packets dropped because the ring was full
+ *
+ * Records start at (@tail & (@size - 1)) and never wrap, a record with
+ * SI468X_DSRV_PAD set fills the end of the area instead.
+ */
+struct si468x_dsrv_ring {
+	__u32 size;
+	__u32 data_offset;
+	__u32 head;
+	__u32 tail;
+	__u32 drops;
+} __packed;
+
+#define SI468X_DSRV_ALIGN	32
+#define SI468X_DSRV_PAD		0x0001
+
+/**
+ * si468x_dsrv_record - one GET_DIGITAL_SERVICE_DATA packet
+ * @len: bytes of header, payload and padding, multiple of
+ * SI468X_DSRV_ALIGN
+ * @flags: SI468X_DSRV_PAD for the filler at the end of the area
+ * @byte_count: payload bytes following the header
+ * @service_id: service the packet belongs to
+ * @comp_id: component of the service
+ * @uatype: user application type
+ * @seg_num: segment number
+ * @num_segs: number of segments
+ * @data_src: 0 = standard data, 1 = non-DLS PAD, 2 = DLS PAD
+ * @dscty: data service component type
+ * @timestamp: CLOCK_MONOTONIC time the packet was read in ns
+ */
+struct si468x_dsrv_record {
+	__u32 len;
+	__u16 flags;
+	__u16 byte_count;
+	__u32 service_id;
+	__u32 comp_id;
+	__u16 uatype;
+	__u16 seg_num;
+	__u16 num_segs;
+	__u8  data_src;
+	__u8  dscty;
+	__u64 timestamp;
+} __packed;
+
 #endif  /* __SI468X_REPORTS_H__ */
@@ -25,6 +25,62 @@ enum si468x_ctrl_id {
 	V4L2_CID_SI468X_RSSI_THRESHOLD	= (V4L2_CID_USER_SI476X_BASE + 1),
 	V4L2_CID_SI468X_SNR_THRESHOLD	= (V4L2_CID_USER_SI476X_BASE + 2),
 	V4L2_CID_SI468X_MAX_TUNE_ERROR	= (V4L2_CID_USER_SI476X_BASE + 3),
+	V4L2_CID_SI468X_SERVICE_FOLLOWING	= (V4L2_CID_USER_SI476X_BASE + 4),
+	V4L2_CID_SI468X_FOLLOW_RSSI_THRESHOLD	= (V4L2_CID_USER_SI476X_BASE + 5),
+	V4L2_CID_SI468X_RDS_MAX_LATENCY	= (V4L2_CID_USER_SI476X_BASE + 6),
+	V4L2_CID_SI468X_FM_AF	= (V4L2_CID_USER_SI476X_BASE + 7),
+	V4L2_CID_SI468X_FM_AF_RSSI_THRESHOLD	= (V4L2_CID_USER_SI476X_BASE + 8),
+	V4L2_CID_SI468X_FM_AF_SNR_THRESHOLD	= (V4L2_CID_USER_SI476X_BASE + 9),
 };
 
+/* private events of the radio device */
+#define V4L2_EVENT_SI468X_MOT_IMAGE	(V4L2_EVENT_PRIVATE_START + 1)
+#define V4L2_EVENT_SI468X_DLS		(V4L2_EVENT_PRIVATE_START + 2)
+#define V4L2_EVENT_SI468X_FOLLOW_FM	(V4L2_EVENT_PRIVATE_START + 3)
+
+/**
+ * struct si468x_mot_image_event - data of V4L2_EVENT_SI468X_MOT_IMAGE
+ * @seq: sequence number, as in si468x_slideshow_info
+ * @service_id: service the image was transported in
+ * @size: bytes of the image in si468x_slideshow
+ * @transport_id: MOT transport id
+ * @content_subtype: 1 for JPEG, 3 for PNG
+ */
+struct si468x_mot_image_event {
+	__u32 seq;
+	__u32 service_id;
+	__u32 size;
+	__u16 transport_id;
+	__u16 content_subtype;
+} __packed;
+
+/**
+ * struct si468x_dls_event - data of V4L2_EVENT_SI468X_DLS
+ * @change: change counter of the label, see si468x_dl_plus
+ * @nr_tags: number of DL Plus tags of the label
+ * @item_toggle: DL Plus item toggle bit
+ * @item_running: DL Plus item running bit
+ * @text: the label, zero terminated, cut to the size of the event
+ */
+struct si468x_dls_event {
+	__u32 change;
+	__u8  nr_tags;
+	__u8  item_toggle;
+	__u8  item_running;
+	char  text[57];
+} __packed;
+
+/**
+ * struct si468x_follow_fm_event - data of V4L2_EVENT_SI468X_FOLLOW_FM
+ * @service_id: DAB service that was lost
+ * @frequency: FM frequency the receiver was tuned to, in the units of
+ * struct v4l2_frequency
+ * @pi: PI code linked to @service_id
+ */
+struct si468x_follow_fm_event {
+	__u32 service_id;
+	__u32 frequency;
+	__u16 pi;
+} __packed;
+
 #endif /* SI468X_H*/